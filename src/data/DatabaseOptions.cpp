@@ -0,0 +1,81 @@
+#include <stdexcept>
+#include <string>
+
+#include <sqlite3.h>
+#include "DatabaseOptions.hpp"
+
+namespace FG::data::internal
+{
+namespace
+{
+const char* toPragmaValue(DatabaseOptions::JournalMode mode)
+{
+    switch(mode)
+    {
+        case DatabaseOptions::JournalMode::Delete:
+            return "DELETE";
+        case DatabaseOptions::JournalMode::Truncate:
+            return "TRUNCATE";
+        case DatabaseOptions::JournalMode::Wal:
+            return "WAL";
+        case DatabaseOptions::JournalMode::Memory:
+            return "MEMORY";
+    }
+    throw std::invalid_argument("Unknown journal mode");
+}
+
+const char* toPragmaValue(DatabaseOptions::Synchronous level)
+{
+    switch(level)
+    {
+        case DatabaseOptions::Synchronous::Off:
+            return "OFF";
+        case DatabaseOptions::Synchronous::Normal:
+            return "NORMAL";
+        case DatabaseOptions::Synchronous::Full:
+            return "FULL";
+        case DatabaseOptions::Synchronous::Extra:
+            return "EXTRA";
+    }
+    throw std::invalid_argument("Unknown synchronous level");
+}
+
+const char* toPragmaValue(DatabaseOptions::TempStore store)
+{
+    switch(store)
+    {
+        case DatabaseOptions::TempStore::Default:
+            return "DEFAULT";
+        case DatabaseOptions::TempStore::File:
+            return "FILE";
+        case DatabaseOptions::TempStore::Memory:
+            return "MEMORY";
+    }
+    throw std::invalid_argument("Unknown temp store");
+}
+
+void executePragma(sqlite3* db, const std::string& pragma)
+{
+    const auto statement = "PRAGMA " + pragma;
+    if(sqlite3_exec(db, statement.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+        throw std::runtime_error("Applying '" + statement + "' failed: " + sqlite3_errmsg(db));
+}
+}
+
+void applyDatabaseOptions(sqlite3* db, const DatabaseOptions& options)
+{
+    //Busy timeout goes first, switching journal mode may need to wait for other connections
+    sqlite3_busy_timeout(db, static_cast<int>(options.busyTimeout.count()));
+    if(options.journalMode)
+        executePragma(db, std::string("journal_mode = ") + toPragmaValue(*options.journalMode));
+    if(options.synchronous)
+        executePragma(db, std::string("synchronous = ") + toPragmaValue(*options.synchronous));
+    //Negative cache size is interpreted by SQLite as number of KiB instead of pages
+    if(options.cacheSizeKiB)
+        executePragma(db, "cache_size = " + std::to_string(-*options.cacheSizeKiB));
+    if(options.mmapSizeBytes)
+        executePragma(db, "mmap_size = " + std::to_string(*options.mmapSizeBytes));
+    if(options.tempStore)
+        executePragma(db, std::string("temp_store = ") + toPragmaValue(*options.tempStore));
+}
+}
\ No newline at end of file
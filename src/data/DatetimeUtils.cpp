@@ -1,11 +1,82 @@
-#include <iomanip>
-#include <ctime>
-#include <sstream>
-#include <time.h>
+#include <stdexcept>
 #include "DatetimeUtils.hpp"
 
 namespace FG::data
 {
+namespace
+{
+bool parseDigits(std::string_view str, std::size_t pos, std::size_t count, int& value)
+{
+    if(pos + count > str.size())
+        return false;
+
+    value = 0;
+    for(auto i = pos; i < pos + count; ++i)
+    {
+        if(str[i] < '0' || str[i] > '9')
+            return false;
+        value = value * 10 + (str[i] - '0');
+    }
+    return true;
+}
+
+//Parses "HH:MM:SS" followed by optional fraction of second (which is truncated) and UTC offset
+bool parseTime(std::string_view timeStr, std::chrono::seconds& time)
+{
+    int hours, minutes, seconds;
+    if(!parseDigits(timeStr, 0, 2, hours) || timeStr.size() < 8 || timeStr[2] != ':'
+       || !parseDigits(timeStr, 3, 2, minutes) || timeStr[5] != ':' || !parseDigits(timeStr, 6, 2, seconds))
+        return false;
+    if(hours > 23 || minutes > 59 || seconds > 59)
+        return false;
+
+    std::size_t pos = 8;
+    if(pos < timeStr.size() && timeStr[pos] == '.')
+    {
+        const auto fractionStart = ++pos;
+        while(pos < timeStr.size() && timeStr[pos] >= '0' && timeStr[pos] <= '9')
+            ++pos;
+        if(pos == fractionStart)
+            return false;
+    }
+
+    time = std::chrono::hours(hours) + std::chrono::minutes(minutes) + std::chrono::seconds(seconds);
+    const auto zone = timeStr.substr(pos);
+    if(zone.empty() || zone == "Z")
+        return true;
+
+    int offsetHours, offsetMinutes;
+    if(zone.size() != 6 || (zone[0] != '+' && zone[0] != '-') || !parseDigits(zone, 1, 2, offsetHours)
+       || zone[3] != ':' || !parseDigits(zone, 4, 2, offsetMinutes) || offsetHours > 23 || offsetMinutes > 59)
+        return false;
+
+    const auto offset = std::chrono::hours(offsetHours) + std::chrono::minutes(offsetMinutes);
+    time += zone[0] == '+' ? -offset : offset;
+    return true;
+}
+
+//Accepts "YYYY-MM-DD" and "YYYY-MM-DDTHH:MM:SS[.fraction][Z|(+|-)HH:MM]", without allocating nor touching locale
+bool parseIsoDatetime(std::string_view dtStr, Timestamp& timestamp)
+{
+    int year, month, day;
+    if(!parseDigits(dtStr, 0, 4, year) || dtStr.size() < 10 || dtStr[4] != '-'
+       || !parseDigits(dtStr, 5, 2, month) || dtStr[7] != '-' || !parseDigits(dtStr, 8, 2, day))
+        return false;
+
+    const std::chrono::year_month_day ymd{
+        std::chrono::year(year), std::chrono::month(static_cast<unsigned>(month)), std::chrono::day(static_cast<unsigned>(day))};
+    if(!ymd.ok())
+        return false;
+
+    std::chrono::seconds time{0};
+    if(dtStr.size() > 10 && ((dtStr[10] != 'T' && dtStr[10] != ' ') || !parseTime(dtStr.substr(11), time)))
+        return false;
+
+    timestamp = (std::chrono::sys_seconds(std::chrono::sys_days(ymd)) + time).time_since_epoch().count();
+    return true;
+}
+}
+
 Timestamp datetimeToUnixTimestamp(const Datetime& dt)
 {
     return std::chrono::time_point_cast<std::chrono::seconds>(dt).time_since_epoch().count();
@@ -19,18 +90,31 @@ Datetime unixTimestampToDatetime(const Timestamp ts)
 
 Timestamp isoDateToTimestamp(std::string_view dtStr)
 {
-    std::tm tm{};
-    std::stringstream ss;
-    ss << dtStr;
-    ss << "T00:00:00";
-    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    if(ss.fail())
+    Timestamp timestamp;
+    if(!parseIsoDatetime(dtStr, timestamp))
         throw std::runtime_error("Parsing date failed");
-    return timegm(&tm);
+    return timestamp;
+}
+
+void isoDatesToTimestamps(std::span<const std::string_view> dtStrs, std::span<Timestamp> timestamps)
+{
+    if(dtStrs.size() != timestamps.size())
+        throw std::invalid_argument("Number of dates and timestamps differ");
+
+    for(std::size_t i = 0; i < dtStrs.size(); ++i)
+    {
+        if(!parseIsoDatetime(dtStrs[i], timestamps[i]))
+            throw std::runtime_error("Parsing date failed");
+    }
 }
 
 Datetime parseIsoDate(std::string_view dtStr)
 {
     return unixTimestampToDatetime(isoDateToTimestamp(dtStr));
 }
+
+Date isoDateToDate(std::string_view dtStr)
+{
+    return Date::fromDatetime(parseIsoDate(dtStr));
+}
 }
\ No newline at end of file
@@ -1,10 +1,326 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "ProductDatabase.hpp"
 
 namespace FG::data
 {
-ProductDatabase::ProductDatabase(const std::string& dbFilePath)
+namespace
+{
+using ConnectionPtr = std::unique_ptr<sqlite3, decltype(&sqlite3_close)>;
+
+//Seconds are floored to days, while SQLite integer division truncates towards zero
+constexpr auto migrateToVersion1 = R"(
+    UPDATE instances SET
+        purchaseDate = purchaseDate / 86400 - (purchaseDate < 0 AND purchaseDate % 86400 != 0),
+        expirationDate = expirationDate / 86400 - (expirationDate < 0 AND expirationDate % 86400 != 0);
+)";
+
+bool isInMemory(const std::string& dbFilePath)
+{
+    return dbFilePath.empty() || dbFilePath == ":memory:";
+}
+
+int queryInt(sqlite3* db, const char* sql)
+{
+    sqlite3_stmt* stmt = nullptr;
+    if(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error(sqlite3_errmsg(db));
+
+    const int result = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+void execute(sqlite3* db, const std::string& sql)
+{
+    if(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::string error = sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        throw std::runtime_error("Database migration failed: " + error);
+    }
+}
+
+//Runs on its own connection, before storage creates or alters any tables
+void migrateSchema(const std::string& dbFilePath)
+{
+    //In-memory database always starts empty, with current schema
+    if(isInMemory(dbFilePath))
+        return;
+
+    sqlite3* rawDb = nullptr;
+    const auto openResult = sqlite3_open(dbFilePath.c_str(), &rawDb);
+    ConnectionPtr db(rawDb, &sqlite3_close);
+    if(openResult != SQLITE_OK)
+        throw std::runtime_error(sqlite3_errmsg(db.get()));
+
+    const auto version = queryInt(db.get(), "PRAGMA user_version");
+    if(version >= ProductDatabase::schemaVersion)
+        return;
+
+    const bool hasInstances = queryInt(db.get(), "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'instances'") > 0;
+    std::string migration = "BEGIN;";
+    if(hasInstances && version < 1)
+        migration += migrateToVersion1;
+    migration += "PRAGMA user_version = " + std::to_string(ProductDatabase::schemaVersion) + "; COMMIT;";
+    execute(db.get(), migration);
+}
+
+//Bounds of unset criteria cover all possible dates, so that the query is the same for any filter
+std::int64_t lowerBound(const std::optional<Date>& from)
+{
+    return from ? from->getDaysSinceEpoch() : std::numeric_limits<Date::rep>::min();
+}
+
+std::int64_t upperBound(const std::optional<Date>& before)
+{
+    return before ? before->getDaysSinceEpoch() : std::int64_t(std::numeric_limits<Date::rep>::max()) + 1;
+}
+
+auto instanceFilterCondition(const InstanceFilter& filter)
+{
+    using namespace sqlite_orm;
+    auto expirationDate = column<ProductInstance>(&ProductInstance::expirationDate);
+    auto purchaseDate = column<ProductInstance>(&ProductInstance::purchaseDate);
+    return where(c(&ProductInstance::isConsumed) >= filter.isConsumed.value_or(false)
+                 and c(&ProductInstance::isConsumed) <= filter.isConsumed.value_or(true)
+                 and c(expirationDate) >= lowerBound(filter.expiringFrom)
+                 and c(expirationDate) < upperBound(filter.expiringBefore)
+                 and c(purchaseDate) >= lowerBound(filter.purchasedFrom)
+                 and c(purchaseDate) < upperBound(filter.purchasedBefore));
+}
+
+//SQL MIN and MAX yield NULL for no rows, sqlite_orm returns them as pointers
+template<typename NullableDate>
+InstanceAggregate makeAggregate(int count, const NullableDate& earliest, const NullableDate& latest)
+{
+    return {static_cast<std::size_t>(count),
+            earliest ? std::optional<Date>(*earliest) : std::nullopt,
+            latest ? std::optional<Date>(*latest) : std::nullopt};
+}
+
+template<typename Rows>
+std::vector<InstanceGroupAggregate> makeGroupAggregates(Rows&& rows)
+{
+    std::vector<InstanceGroupAggregate> groups;
+    groups.reserve(rows.size());
+    for(auto& [id, name, count, earliest, latest] : rows)
+        groups.push_back({id, std::move(name), makeAggregate(count, earliest, latest)});
+    return groups;
+}
+}
+
+namespace internal
+{
+ReadConnection::ReadConnection(const std::string& dbFilePath, const DatabaseOptions& options)
+    : storage(makeStorage(dbFilePath))
+{
+    storage.on_open = [options](sqlite3* db) {
+        applyDatabaseOptions(db, options);
+        //Guards against write slipping in through connection which is shared between threads without any lock
+        sqlite3_exec(db, "PRAGMA query_only = 1", nullptr, nullptr, nullptr);
+    };
+    storage.open_forever();
+}
+}
+
+ProductDatabase::ProductDatabase(const std::string& dbFilePath, const DatabaseOptions& options)
     : Base(), storage(internal::makeStorage(dbFilePath))
 {
+    migrateSchema(dbFilePath);
+    storage.on_open = [options](sqlite3* db) {
+        internal::applyDatabaseOptions(db, options);
+    };
+    //Page cache and memory mapping live as long as the connection, so it's not reopened for every query.
+    //In-memory database is opened by the storage right away, before its open callback could be set.
+    if(isInMemory(dbFilePath))
+        internal::applyDatabaseOptions(storage.get_connection().get(), options);
+    else
+        storage.open_forever();
     storage.sync_schema();
+
+    //In-memory database exists only within its single connection, so its reads are serialized with writes instead
+    if(internal::threadSafe && !isInMemory(dbFilePath))
+    {
+        const auto maxConnections = options.maxReadConnections > 0
+            ? options.maxReadConnections
+            : std::max(1u, std::thread::hardware_concurrency());
+        readConnections.emplace([dbFilePath, options] {
+            return std::make_unique<internal::ReadConnection>(dbFilePath, options);
+        }, maxConnections);
+    }
+}
+
+std::vector<ExpirationEntry> ProductDatabase::findExpiring(Date from, Date to)
+{
+    return queryExpirationIndex([from, to](const internal::ExpirationIndex& index) {
+        return index.findBetween(from, to);
+    });
+}
+
+std::vector<ExpirationEntry> ProductDatabase::findSoonestExpiring(std::size_t count, Date from)
+{
+    return queryExpirationIndex([count, from](const internal::ExpirationIndex& index) {
+        return index.findSoonest(count, from);
+    });
+}
+
+std::vector<EntityPtr<ProductInstance>> ProductDatabase::retrieveExpiring(Date from, Date to)
+{
+    const auto entries = findExpiring(from, to);
+    std::set<Id> ids;
+    std::unordered_map<Id, std::size_t> positions;
+    positions.reserve(entries.size());
+    for(std::size_t i = 0; i < entries.size(); ++i)
+    {
+        ids.insert(entries[i].id);
+        positions.emplace(entries[i].id, i);
+    }
+
+    //Instances are retrieved in order of their IDs, but they are expected in order of expiration
+    auto instances = retrieve<ProductInstance>(ids);
+    std::vector<EntityPtr<ProductInstance>> orderedInstances(entries.size());
+    for(auto& instance : instances)
+        orderedInstances[positions.at(instance->getId())] = std::move(instance);
+    std::erase(orderedInstances, nullptr);
+    return orderedInstances;
+}
+
+EntityPtr<ProductDescription> ProductDatabase::findByBarcode(std::string_view barcode)
+{
+    const auto id = queryBarcodeIndex([barcode](const internal::BarcodeIndex& index) {
+        return index.find(barcode);
+    });
+    if(!id)
+        return nullptr;
+    return retrieve<ProductDescription>(*id);
+}
+
+std::vector<EntityPtr<ProductDescription>> ProductDatabase::findByBarcodes(const std::vector<std::string_view>& barcodes)
+{
+    std::vector<Id> foundIds;
+    foundIds.reserve(barcodes.size());
+    std::set<Id> ids;
+    queryBarcodeIndex([&](const internal::BarcodeIndex& index) {
+        for(auto barcode : barcodes)
+        {
+            foundIds.push_back(index.find(barcode).value_or(uninitializedId));
+            if(foundIds.back() != uninitializedId)
+                ids.insert(foundIds.back());
+        }
+    });
+
+    //Descriptions missing in cache are retrieved with a single query
+    const auto descriptions = retrieve<ProductDescription>(ids);
+    std::vector<EntityPtr<ProductDescription>> foundDescriptions;
+    foundDescriptions.reserve(barcodes.size());
+    for(auto id : foundIds)
+    {
+        auto descriptionIt = std::ranges::lower_bound(descriptions, id, {}, [](const auto& description) { return description->getId(); });
+        if(descriptionIt != descriptions.end() && (*descriptionIt)->getId() == id)
+            foundDescriptions.push_back(*descriptionIt);
+        else
+            foundDescriptions.emplace_back(nullptr);
+    }
+    return foundDescriptions;
+}
+
+InstanceAggregate ProductDatabase::aggregateInstances(const InstanceFilter& filter)
+{
+    auto rows = read([&filter](StorageT& readStorage, internal::ProductStatements&) {
+        using namespace sqlite_orm;
+        auto expirationDate = column<ProductInstance>(&ProductInstance::expirationDate);
+        return readStorage.select(
+            columns(count(column<ProductInstance>(&ProductInstance::getId)), min(expirationDate), max(expirationDate)),
+            instanceFilterCondition(filter));
+    });
+
+    //Aggregate query without GROUP BY always yields exactly one row
+    auto& [count, earliest, latest] = rows.front();
+    return makeAggregate(count, earliest, latest);
+}
+
+std::vector<InstanceGroupAggregate> ProductDatabase::aggregateInstancesBy(InstanceGrouping grouping, const InstanceFilter& filter)
+{
+    return read([grouping, &filter](StorageT& readStorage, internal::ProductStatements&) {
+        using namespace sqlite_orm;
+        auto instanceId = column<ProductInstance>(&ProductInstance::getId);
+        auto expirationDate = column<ProductInstance>(&ProductInstance::expirationDate);
+        auto descriptionId = column<ProductDescription>(&ProductDescription::getId);
+        auto joinDescriptions = inner_join<ProductDescription>(on(c(column<ProductInstance>(&ProductInstance::getFkId)) == descriptionId));
+        if(grouping == InstanceGrouping::Description)
+        {
+            return makeGroupAggregates(readStorage.select(
+                columns(descriptionId, column<ProductDescription>(&ProductDescription::name),
+                        count(instanceId), min(expirationDate), max(expirationDate)),
+                joinDescriptions, instanceFilterCondition(filter), group_by(descriptionId), order_by(descriptionId)));
+        }
+
+        auto categoryId = column<ProductCategory>(&ProductCategory::getId);
+        return makeGroupAggregates(readStorage.select(
+            columns(categoryId, column<ProductCategory>(&ProductCategory::name),
+                    count(instanceId), min(expirationDate), max(expirationDate)),
+            joinDescriptions,
+            inner_join<ProductCategory>(on(c(column<ProductDescription>(&ProductDescription::getFkId)) == categoryId)),
+            instanceFilterCondition(filter), group_by(categoryId), order_by(categoryId)));
+    });
+}
+
+void ProductDatabase::updateIndexes(const ProductDescription& description)
+{
+    std::lock_guard lock(indexesMutex);
+    if(barcodeIndex)
+        barcodeIndex->update(description.getId(), description.barcode);
+}
+
+void ProductDatabase::updateIndexes(const ProductInstance& instance)
+{
+    std::lock_guard lock(indexesMutex);
+    if(expirationIndex)
+        expirationIndex->update(instance.getId(), instance.expirationDate, instance.isConsumed);
+}
+
+void ProductDatabase::removeFromIndexes(const ProductDescription& description)
+{
+    std::lock_guard lock(indexesMutex);
+    if(barcodeIndex)
+        barcodeIndex->erase(description.getId());
+}
+
+void ProductDatabase::removeFromIndexes(const ProductInstance& instance)
+{
+    std::lock_guard lock(indexesMutex);
+    if(expirationIndex)
+        expirationIndex->erase(instance.getId());
+}
+
+void ProductDatabase::buildExpirationIndex(internal::ExpirationIndex& index)
+{
+    using namespace sqlite_orm;
+    auto rows = storage.select(
+        columns(column<ProductInstance>(&ProductInstance::getId), column<ProductInstance>(&ProductInstance::expirationDate)),
+        where(c(&ProductInstance::isConsumed) == false));
+    for(const auto& [id, expirationDate] : rows)
+        index.update(id, expirationDate, false);
+}
+
+void ProductDatabase::buildBarcodeIndex(internal::BarcodeIndex& index)
+{
+    using namespace sqlite_orm;
+    auto rows = storage.select(
+        columns(column<ProductDescription>(&ProductDescription::getId), &ProductDescription::barcode),
+        where(is_not_null(&ProductDescription::barcode)));
+    for(const auto& [id, barcode] : rows)
+        index.update(id, barcode);
 }
 }
\ No newline at end of file
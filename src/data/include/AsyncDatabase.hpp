@@ -0,0 +1,418 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Database.hpp"
+
+namespace FG::data
+{
+namespace internal
+{
+template<typename DbImpl, typename... Entities>
+std::tuple<Entities...> databaseEntities(const Database<DbImpl, Entities...>&);
+
+template<typename EntityT>
+using PinnedEntities = std::unordered_map<const EntityT*, EntityPtr<EntityT>>;
+
+template<typename EntitiesTuple>
+struct PinnedEntitiesTuple;
+
+template<typename... Entities>
+struct PinnedEntitiesTuple<std::tuple<Entities...>>
+{
+    using type = std::tuple<PinnedEntities<Entities>...>;
+};
+
+//Handles nested in user-defined structs can't be detected
+template<typename T>
+struct HoldsEntityHandles : std::false_type
+{};
+
+template<typename EntityT>
+struct HoldsEntityHandles<EntityPtr<EntityT>> : std::true_type
+{};
+
+template<typename EntityT>
+struct HoldsEntityHandles<LazyEntityPtr<EntityT>> : std::true_type
+{};
+
+template<typename EntityT, typename SortT>
+struct HoldsEntityHandles<Page<EntityT, SortT>> : std::true_type
+{};
+
+template<typename T>
+struct HoldsEntityHandles<Generator<T>> : std::true_type
+{};
+
+template<typename T, typename Alloc>
+struct HoldsEntityHandles<std::vector<T, Alloc>> : HoldsEntityHandles<T>
+{};
+
+template<typename T>
+struct HoldsEntityHandles<std::optional<T>> : HoldsEntityHandles<T>
+{};
+
+template<typename... T>
+struct HoldsEntityHandles<std::tuple<T...>> : std::disjunction<HoldsEntityHandles<T>...>
+{};
+
+template<typename T, typename U>
+struct HoldsEntityHandles<std::pair<T, U>> : std::disjunction<HoldsEntityHandles<T>, HoldsEntityHandles<U>>
+{};
+
+template<typename T>
+struct IsPinnable : std::false_type
+{};
+
+template<typename EntityT>
+struct IsPinnable<EntityPtr<EntityT>> : std::true_type
+{};
+
+template<typename EntityT>
+struct IsPinnable<std::vector<EntityPtr<EntityT>>> : std::true_type
+{};
+}
+
+//Runs all operations of wrapped database on a dedicated worker thread, in order of their submission.
+//Consecutive writes are coalesced into one session, so they get committed in a single transaction.
+//Entities may be read on any thread, but mustn't be modified while their commit is still pending.
+//Every entity handed out stays pinned by the worker, so that it's always released on the worker thread.
+//Only EntityPtr and vectors of them may be handed out, results holding any other handles are rejected.
+template<typename DbT>
+class AsyncDatabase
+{
+    static_assert(internal::threadSafe, "Entity handles cross threads, data layer has to be built with FG_DATA_THREAD_SAFE");
+
+public:
+    //Delivers result callbacks, e.g. by posting them to caller's event loop
+    using Dispatcher = std::function<void(std::function<void()>)>;
+
+    //While idle with entities pinned, worker checks this often whether callers have dropped them
+    static constexpr std::chrono::milliseconds idlePinReleaseInterval{200};
+
+    template<typename... Args>
+    explicit AsyncDatabase(Dispatcher resultDispatcher, Args&&... dbArgs)
+        : db(std::forward<Args>(dbArgs)...), dispatcher(std::move(resultDispatcher)), worker([this] { run(); })
+    {}
+
+    AsyncDatabase(const AsyncDatabase&) = delete;
+    AsyncDatabase& operator=(const AsyncDatabase&) = delete;
+
+    //Requests already submitted are still executed
+    ~AsyncDatabase()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        requestAdded.notify_one();
+        worker.join();
+    }
+
+    template<typename EntityT, typename... Args>
+    std::future<EntityPtr<EntityT>> create(Args&&... args)
+    {
+        return submit(RequestKind::Write, [... args = std::forward<Args>(args)](DbT& database) mutable {
+            return database.template create<EntityT>(std::move(args)...);
+        });
+    }
+
+    template<typename EntityT>
+    std::future<EntityPtr<EntityT>> retrieve(Id id)
+    {
+        return submit(RequestKind::Read, [id](DbT& database) {
+            return database.template retrieve<EntityT>(id);
+        });
+    }
+
+    template<typename EntityT>
+    std::future<std::vector<EntityPtr<EntityT>>> retrieve(std::set<Id> ids)
+    {
+        return submit(RequestKind::Read, [ids = std::move(ids)](DbT& database) {
+            return database.template retrieve<EntityT>(ids);
+        });
+    }
+
+    template<typename EntityT>
+    std::future<std::vector<EntityPtr<EntityT>>> retrieveAll()
+    {
+        return submit(RequestKind::Read, [](DbT& database) {
+            return database.template retrieveAll<EntityT>();
+        });
+    }
+
+    template<typename EntityT>
+    std::future<void> commitChanges(EntityPtr<EntityT> entity)
+    {
+        return submit(RequestKind::Write, [entity = std::move(entity)](DbT& database) mutable {
+            database.commitChanges(entity);
+        });
+    }
+
+    template<typename EntityT>
+    std::future<void> remove(EntityPtr<EntityT> entity)
+    {
+        return submit(RequestKind::Write, [entity = std::move(entity)](DbT& database) mutable {
+            database.remove(std::move(entity));
+        });
+    }
+
+    //Runs arbitrary function on the worker thread, outside of write batches
+    template<typename Func>
+    auto execute(Func&& func)
+    {
+        return submit(RequestKind::Read, std::forward<Func>(func));
+    }
+
+    //Result is passed to the callback through dispatcher, or on the worker thread if there's none
+    template<typename Func, typename Callback>
+    void execute(Func&& func, Callback&& onResult)
+    {
+        submit(RequestKind::Read, std::forward<Func>(func), std::forward<Callback>(onResult));
+    }
+
+private:
+    enum class RequestKind
+    {
+        Read,
+        Write
+    };
+
+    struct Request
+    {
+        RequestKind kind;
+        std::function<void(DbT&)> execute;
+        std::function<void(std::exception_ptr)> complete;
+        std::exception_ptr error;
+    };
+
+    template<typename Result>
+    struct RequestState
+    {
+        std::promise<Result> promise;
+        std::optional<std::conditional_t<std::is_void_v<Result>, bool, Result>> result;
+        std::function<void(std::future<Result>)> callback;
+    };
+
+    template<typename Func, typename... Callback>
+    auto submit(RequestKind kind, Func&& func, Callback&&... onResult)
+    {
+        using Result = std::invoke_result_t<std::decay_t<Func>&, DbT&>;
+        static_assert(!internal::HoldsEntityHandles<Result>::value || internal::IsPinnable<Result>::value,
+                      "Entity handles can be handed out only as EntityPtr or vector of them, others wouldn't be pinned");
+        auto state = std::make_shared<RequestState<Result>>();
+        if constexpr(sizeof...(Callback) > 0)
+            state->callback = std::function<void(std::future<Result>)>(std::forward<Callback>(onResult)...);
+        auto future = state->callback ? std::future<Result>() : state->promise.get_future();
+
+        Request request{kind,
+            [state, func = std::forward<Func>(func)](DbT& database) mutable {
+                if constexpr(std::is_void_v<Result>)
+                    func(database);
+                else
+                    state->result.emplace(func(database));
+            },
+            [this, state](std::exception_ptr error) {
+                if constexpr(!std::is_void_v<Result>)
+                {
+                    //Pinning retrieves FK entities, so it may fail as well
+                    try
+                    {
+                        if(!error)
+                            pin(*state->result);
+                    }
+                    catch(...)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+
+                if(error)
+                    state->promise.set_exception(error);
+                else if constexpr(std::is_void_v<Result>)
+                    state->promise.set_value();
+                else
+                    state->promise.set_value(std::move(*state->result));
+
+                if(state->callback)
+                    deliver(std::move(state->callback), state->promise.get_future());
+            }};
+
+        {
+            std::lock_guard lock(mutex);
+            requests.push_back(std::move(request));
+        }
+        requestAdded.notify_one();
+
+        if constexpr(sizeof...(Callback) == 0)
+            return future;
+    }
+
+    template<typename Result>
+    void deliver(std::function<void(std::future<Result>)>&& callback, std::future<Result>&& result)
+    {
+        auto task = [callback = std::move(callback), result = std::make_shared<std::future<Result>>(std::move(result))] {
+            callback(std::move(*result));
+        };
+
+        if(dispatcher)
+            dispatcher(std::move(task));
+        else
+            task();
+    }
+
+    void run()
+    {
+        std::unique_lock lock(mutex);
+        const auto hasWork = [this] { return stopping || !requests.empty(); };
+        while(true)
+        {
+            if(!hasPins())
+                requestAdded.wait(lock, hasWork);
+            else if(!requestAdded.wait_for(lock, idlePinReleaseInterval, hasWork))
+            {
+                lock.unlock();
+                releaseUnusedPins();
+                lock.lock();
+                continue;
+            }
+            if(requests.empty())
+                return;
+
+            auto pending = std::exchange(requests, {});
+            lock.unlock();
+            process(pending);
+            releaseUnusedPins();
+            lock.lock();
+        }
+    }
+
+    void process(std::vector<Request>& pending)
+    {
+        for(auto requestIt = pending.begin(); requestIt != pending.end();)
+        {
+            if(requestIt->kind == RequestKind::Read)
+            {
+                executeRequest(*requestIt);
+                requestIt->complete(requestIt->error);
+                ++requestIt;
+                continue;
+            }
+
+            auto writesEnd = std::find_if(requestIt, pending.end(), [](const Request& request) {
+                return request.kind != RequestKind::Write;
+            });
+            executeWrites(requestIt, writesEnd);
+            requestIt = writesEnd;
+        }
+    }
+
+    void executeWrites(std::vector<Request>::iterator writesBegin, std::vector<Request>::iterator writesEnd)
+    {
+        //Failure of single request doesn't affect the others, but failed commit fails the whole batch
+        std::exception_ptr commitError;
+        try
+        {
+            auto session = db.startSession();
+            for(auto requestIt = writesBegin; requestIt != writesEnd; ++requestIt)
+                executeRequest(*requestIt);
+            session.commit();
+        }
+        catch(...)
+        {
+            commitError = std::current_exception();
+        }
+
+        for(auto requestIt = writesBegin; requestIt != writesEnd; ++requestIt)
+            requestIt->complete(requestIt->error ? requestIt->error : commitError);
+    }
+
+    void executeRequest(Request& request)
+    {
+        try
+        {
+            request.execute(db);
+        }
+        catch(...)
+        {
+            request.error = std::current_exception();
+        }
+    }
+
+    template<typename Result>
+    void pin(const Result&)
+    {}
+
+    template<typename EntityT>
+    void pin(const std::vector<EntityPtr<EntityT>>& entities)
+    {
+        for(const auto& entity : entities)
+            pin(entity);
+    }
+
+    template<typename EntityT>
+    void pin(const EntityPtr<EntityT>& entity)
+    {
+        if(!entity)
+            return;
+
+        std::get<internal::PinnedEntities<EntityT>>(pinned).try_emplace(entity.get(), entity);
+        //Handle to FK entity can be copied out of the entity, so it has to be pinned as well
+        if constexpr(WithFkEntity<EntityT>)
+        {
+            if(entity->getFkId() != uninitializedId)
+                pin(db.template retrieve<typename EntityT::FkEntity>(entity->getFkId()));
+        }
+    }
+
+    bool hasPins() const
+    {
+        return std::apply([](const auto&... pinnedEntities) { return (!pinnedEntities.empty() || ...); }, pinned);
+    }
+
+    void releaseUnusedPins()
+    {
+        [this]<std::size_t... I>(std::index_sequence<I...>) {
+            //Dependent entities go first, as they keep their FK entities referenced
+            (releaseUnusedPins(std::get<sizeof...(I) - 1 - I>(pinned)), ...);
+        }(std::make_index_sequence<std::tuple_size_v<decltype(pinned)>>{});
+    }
+
+    template<typename EntityT>
+    static void releaseUnusedPins(internal::PinnedEntities<EntityT>& pinnedEntities)
+    {
+        for(auto pinnedIt = pinnedEntities.begin(); pinnedIt != pinnedEntities.end();)
+        {
+            if(pinnedIt->second.resetIfLast())
+                pinnedIt = pinnedEntities.erase(pinnedIt);
+            else
+                ++pinnedIt;
+        }
+    }
+
+    DbT db;
+    typename internal::PinnedEntitiesTuple<decltype(internal::databaseEntities(std::declval<DbT&>()))>::type pinned;
+    Dispatcher dispatcher;
+    std::mutex mutex;
+    std::condition_variable requestAdded;
+    std::vector<Request> requests;
+    bool stopping = false;
+    //Started last, once everything it uses is already constructed
+    std::thread worker;
+};
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "AsyncDatabase.hpp"
+#include "ProductDatabase.hpp"
+
+namespace FG::data
+{
+//Keeps disk I/O of ProductDatabase away from the GUI thread.
+//FK entities are always loaded eagerly, as resolving them lazily would query the database on caller's thread.
+class AsyncProductDatabase : public AsyncDatabase<ProductDatabase>
+{
+public:
+    explicit AsyncProductDatabase(const std::string& dbFilePath = "", const DatabaseOptions& options = {},
+                                  Dispatcher resultDispatcher = {})
+        : AsyncDatabase(std::move(resultDispatcher), dbFilePath, options)
+    {}
+};
+}
\ No newline at end of file
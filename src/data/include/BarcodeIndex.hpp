@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "EntityUtils.hpp"
+
+namespace FG::data
+{
+namespace internal
+{
+//Maps barcodes to IDs of product descriptions. Barcodes aren't unique in DB, so every one of them
+//keeps IDs of all descriptions sharing it, and the lowest of them is found.
+class BarcodeIndex
+{
+public:
+    void update(Id id, const Nullable<std::string>& barcode)
+    {
+        auto barcodeIt = barcodesById.find(id);
+        if(barcodeIt != barcodesById.end())
+        {
+            if(barcode && barcodeIt->second == *barcode)
+                return;
+
+            auto idsIt = idsByBarcode.find(barcodeIt->second);
+            std::erase(idsIt->second, id);
+            if(idsIt->second.empty())
+                idsByBarcode.erase(idsIt);
+            barcodesById.erase(barcodeIt);
+        }
+
+        if(!barcode)
+            return;
+        auto& ids = idsByBarcode[*barcode];
+        ids.insert(std::ranges::lower_bound(ids, id), id);
+        barcodesById.emplace(id, *barcode);
+    }
+
+    void erase(Id id)
+    {
+        update(id, std::nullopt);
+    }
+
+    std::optional<Id> find(std::string_view barcode) const
+    {
+        auto idsIt = idsByBarcode.find(barcode);
+        if(idsIt == idsByBarcode.end())
+            return std::nullopt;
+        return idsIt->second.front();
+    }
+
+    std::size_t size() const
+    {
+        return idsByBarcode.size();
+    }
+
+private:
+    struct BarcodeHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view barcode) const
+        {
+            return std::hash<std::string_view>{}(barcode);
+        }
+    };
+
+    //Most barcodes belong to a single description, so IDs are kept in small sorted vectors
+    std::unordered_map<std::string, std::vector<Id>, BarcodeHash, std::equal_to<>> idsByBarcode;
+    std::unordered_map<Id, std::string> barcodesById;
+};
+}
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "EntityUtils.hpp"
+
+namespace FG::data
+{
+enum class ChangeKind
+{
+    Created,
+    Updated,
+    Removed
+};
+
+//Latest change of every entity of given type, earlier changes of the same entity are folded into it
+template<typename EntityT>
+class EntityChanges
+{
+public:
+    void add(ChangeKind kind, Id id)
+    {
+        auto [changeIt, inserted] = changes.try_emplace(id, kind);
+        if(inserted)
+            return;
+
+        //Entity created and removed before anyone heard of it never existed for listeners
+        if(changeIt->second == ChangeKind::Created && kind == ChangeKind::Removed)
+            changes.erase(changeIt);
+        else if(changeIt->second != ChangeKind::Created)
+            changeIt->second = kind;
+    }
+
+    void merge(const EntityChanges& other)
+    {
+        for(const auto& [id, kind] : other.changes)
+            add(kind, id);
+    }
+
+    std::vector<Id> getIds(ChangeKind kind) const
+    {
+        std::vector<Id> ids;
+        for(const auto& [id, changeKind] : changes)
+        {
+            if(changeKind == kind)
+                ids.push_back(id);
+        }
+        return ids;
+    }
+
+    const std::map<Id, ChangeKind>& getAll() const
+    {
+        return changes;
+    }
+
+    bool empty() const
+    {
+        return changes.empty();
+    }
+
+private:
+    std::map<Id, ChangeKind> changes;
+};
+
+template<typename... Entities>
+class ChangeSet
+{
+public:
+    template<typename EntityT>
+    void add(ChangeKind kind, Id id)
+    {
+        get<EntityT>().add(kind, id);
+    }
+
+    void merge(const ChangeSet& other)
+    {
+        (get<Entities>().merge(other.get<Entities>()), ...);
+    }
+
+    template<typename EntityT>
+    EntityChanges<EntityT>& get()
+    {
+        return std::get<EntityChanges<EntityT>>(changes);
+    }
+
+    template<typename EntityT>
+    const EntityChanges<EntityT>& get() const
+    {
+        return std::get<EntityChanges<EntityT>>(changes);
+    }
+
+    bool empty() const
+    {
+        return (get<Entities>().empty() && ...);
+    }
+
+private:
+    std::tuple<EntityChanges<Entities>...> changes;
+};
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace FG::data::internal
+{
+//Connections are opened on demand up to the limit, then callers wait for one of them to be given back
+template<typename ConnectionT>
+class ConnectionPool
+{
+public:
+    using Factory = std::function<std::unique_ptr<ConnectionT>()>;
+
+    class Lease
+    {
+    public:
+        Lease(ConnectionPool& connectionPool, std::unique_ptr<ConnectionT>&& leasedConnection)
+            : pool(&connectionPool), connection(std::move(leasedConnection))
+        {}
+
+        Lease(Lease&& other) noexcept = default;
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease()
+        {
+            if(connection)
+                pool->giveBack(std::move(connection));
+        }
+
+        ConnectionT& operator*() const
+        {
+            return *connection;
+        }
+
+        ConnectionT* operator->() const
+        {
+            return connection.get();
+        }
+
+    private:
+        ConnectionPool* pool;
+        std::unique_ptr<ConnectionT> connection;
+    };
+
+    ConnectionPool(Factory connectionFactory, std::size_t maxConnectionsCount)
+        : factory(std::move(connectionFactory)), maxConnections(maxConnectionsCount)
+    {}
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    Lease acquire()
+    {
+        std::unique_lock lock(mutex);
+        connectionReturned.wait(lock, [this] { return !idle.empty() || openedCount < maxConnections; });
+        if(!idle.empty())
+        {
+            auto connection = std::move(idle.back());
+            idle.pop_back();
+            return Lease(*this, std::move(connection));
+        }
+
+        //Opening connection may take a while, other threads shouldn't wait for it
+        ++openedCount;
+        lock.unlock();
+        try
+        {
+            return Lease(*this, factory());
+        }
+        catch(...)
+        {
+            lock.lock();
+            --openedCount;
+            connectionReturned.notify_one();
+            throw;
+        }
+    }
+
+    std::size_t getOpenedCount() const
+    {
+        std::lock_guard lock(mutex);
+        return openedCount;
+    }
+
+private:
+    void giveBack(std::unique_ptr<ConnectionT>&& connection)
+    {
+        {
+            std::lock_guard lock(mutex);
+            idle.push_back(std::move(connection));
+        }
+        connectionReturned.notify_one();
+    }
+
+    Factory factory;
+    const std::size_t maxConnections;
+    mutable std::mutex mutex;
+    std::condition_variable connectionReturned;
+    std::vector<std::unique_ptr<ConnectionT>> idle;
+    std::size_t openedCount = 0;
+};
+}
\ No newline at end of file
@@ -1,62 +1,245 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <functional>
 #include <iterator>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <sqlite_orm/sqlite_orm.h>
+#include "ChangeSet.hpp"
 #include "DbEntity.hpp"
+#include "EntityCache.hpp"
+#include "Generator.hpp"
+#include "LazyEntityPtr.hpp"
+#include "PendingChanges.hpp"
+#include "Synchronization.hpp"
 
 namespace FG::data
 {
+enum class RefreshPolicy
+{
+    KeepCached,
+    RefreshFromDb
+};
+
+enum class FkLoadingPolicy
+{
+    Eager,
+    //Applies only to entities keeping their FK entity in LazyEntityPtr
+    Lazy,
+    //Whole chain of FK entities is read in the same query as entities themselves, wherever database implementation
+    //supports it for given kind of retrieval, otherwise it works like Eager
+    Joined
+};
+
+enum class SortOrder
+{
+    Ascending,
+    Descending
+};
+
+//Position of the last entity of a page, ID makes it unique among entities with equal sort values
+template<typename SortT>
+struct PageKey
+{
+    SortT sortValue;
+    Id id;
+
+    bool operator==(const PageKey&) const = default;
+};
+
+template<typename EntityT, typename SortT>
+struct Page
+{
+    std::vector<EntityPtr<EntityT>> entities;
+    //Empty if there are no more entities to retrieve
+    std::optional<PageKey<SortT>> nextKey;
+};
+
+template<typename EntityT, typename OrderBy>
+using SortValueType = std::remove_cvref_t<std::invoke_result_t<OrderBy, const EntityT&>>;
+
+//In thread safe build entities can be retrieved from many threads at once, as long as changes,
+//sessions and policies are handled by a single writer thread
 template<class DbImpl, typename... Entities>
 class Database
 {
 public:
+    using Changes = ChangeSet<Entities...>;
+    using ChangeListener = std::function<void(const Changes&)>;
+    using ListenerId = std::size_t;
+
+    //Nested sessions join the outermost one, which alone decides whether all their changes get flushed or discarded
+    class Session
+    {
+    public:
+        explicit Session(Database& database) : db(database)
+        {
+            ++db.sessionDepth;
+        }
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        //Changes of outermost session which wasn't committed are discarded
+        ~Session()
+        {
+            if(!finished && --db.sessionDepth == 0)
+                db.discardPendingChanges();
+        }
+
+        //Flushes recorded changes in a single transaction, they are discarded if it fails
+        void commit()
+        {
+            if(finished)
+                throw std::logic_error("Session already finished");
+
+            finished = true;
+            if(--db.sessionDepth == 0)
+                db.flushPendingChanges();
+        }
+
+    private:
+        Database& db;
+        bool finished = false;
+    };
+
+    //Entities created or retrieved within the scope, on the thread which opened it, get allocated from given arena
+    //instead of the pools, so the arena has to outlive every EntityPtr obtained meanwhile.
+    //They are cached apart from the other entities and forgotten once the scope ends, so that no later retrieval
+    //returns them. Entities from outside the scope mustn't get FK handles to them meanwhile, so their lazy FK handles
+    //shouldn't be resolved and they shouldn't be refreshed from DB within the scope.
+    //Scopes can't be nested, opening one while another is open throws std::logic_error.
+    class ArenaScope
+    {
+    public:
+        ArenaScope(Database& database, std::pmr::memory_resource& arena)
+            : db(database)
+        {
+            db.setArena(&arena);
+        }
+
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+
+        ~ArenaScope()
+        {
+            db.setArena(nullptr);
+        }
+
+    private:
+        Database& db;
+    };
+
+    Session startSession()
+    {
+        return Session(*this);
+    }
+
+    ArenaScope useArena(std::pmr::memory_resource& arena)
+    {
+        return ArenaScope(*this, arena);
+    }
+
+    template<typename EntityT>
+    const AllocationStats& getAllocationStats()
+    {
+        return getCache<EntityT>().getAllocationStats();
+    }
+
     template<typename EntityT, typename... Args>
     EntityPtr<EntityT> create(Args&&... args)
     {
-        auto& cache = getCache<EntityT>();
-        const auto& entityPtr = *cache.insert(cache.end(), std::make_shared<EntityT>(typename EntityT::SchemaType{args...}));
-        getImpl().insertImpl(*entityPtr);
-        return {entityPtr, cache};
+        return insert(EntityPtr<EntityT>(getCache<EntityT>().make(typename EntityT::SchemaType{args...})));
     }
 
     template<typename EntityT, typename FkEntityT, typename... Args>
     EntityPtr<EntityT> create(EntityPtr<FkEntityT> fkEntity, Args&&... args)
+    {
+        return insert(EntityPtr<EntityT>(getCache<EntityT>().make(fkEntity, typename EntityT::SchemaType{args...})));
+    }
+
+    template<typename EntityT, std::ranges::input_range Range>
+    std::vector<EntityPtr<EntityT>> createMany(Range&& schemas)
     {
         auto& cache = getCache<EntityT>();
-        auto& entityPtr = *cache.insert(cache.end(), std::make_shared<EntityT>(fkEntity, typename EntityT::SchemaType{args...}));
-        getImpl().insertImpl(*entityPtr);
-        return {entityPtr, cache};
+        std::vector<EntityPtr<EntityT>> entities;
+        if constexpr(std::ranges::sized_range<Range>)
+            entities.reserve(std::ranges::size(schemas));
+        for(const auto& schema : schemas)
+            entities.emplace_back(cache.make(typename EntityT::SchemaType(schema)));
+        return insertMany(std::move(entities));
+    }
+
+    template<typename EntityT, typename FkEntityT, std::ranges::input_range Range>
+    std::vector<EntityPtr<EntityT>> createMany(EntityPtr<FkEntityT> fkEntity, Range&& schemas)
+    {
+        auto& cache = getCache<EntityT>();
+        std::vector<EntityPtr<EntityT>> entities;
+        if constexpr(std::ranges::sized_range<Range>)
+            entities.reserve(std::ranges::size(schemas));
+        for(const auto& schema : schemas)
+            entities.emplace_back(cache.make(fkEntity, typename EntityT::SchemaType(schema)));
+        return insertMany(std::move(entities));
     }
 
     template<typename EntityT>
     EntityPtr<EntityT> retrieve(Id id)
     {
         auto& cache = getCache<EntityT>();
-        auto entityIt = cache.find(id);
-        if(entityIt != cache.end() && (*entityIt)->isValid())
-            return {*entityIt, cache};
+        if(auto entityPtr = cache.acquire(id); entityPtr && entityPtr->isValid())
+            return entityPtr;
 
-        auto& entityPtr = *cache.insert(cache.end(), std::make_shared<EntityT>(retrieveFromDb<EntityT>(id)));
-        return {entityPtr, cache};
+        //Other thread could have cached the same entity meanwhile
+        return cache.insertOrAcquire(EntityPtr<EntityT>(cache.make(retrieveFromDb<EntityT>(id))));
     }
 
-    template<typename EntityT, typename... Conditions>
-    std::vector<EntityPtr<EntityT>> retrieve(Conditions&&... cond)
+    //Entities are ordered by their IDs, whatever order the underlying DB returns them in
+    template<typename EntityT>
+    std::vector<EntityPtr<EntityT>> retrieve(const std::set<Id>& ids)
     {
         auto& cache = getCache<EntityT>();
-        auto entities = retrieveFromDb<EntityT>(cond...);
         std::vector<EntityPtr<EntityT>> entitiesPtrs;
-        entitiesPtrs.reserve(entities.size());
-        for(auto &e : entities)
+        entitiesPtrs.reserve(ids.size());
+        std::set<Id> missingIds;
+        for(Id id : ids)
         {
-            const auto& [entityPtrIterator, _] = cache.insert(std::make_shared<EntityT>(std::move(e)));
-            entitiesPtrs.emplace_back(*entityPtrIterator, cache);
+            if(auto entityPtr = cache.acquire(id); entityPtr && entityPtr->isValid())
+                entitiesPtrs.push_back(std::move(entityPtr));
+            else
+                missingIds.insert(missingIds.end(), id);
         }
 
+        if(missingIds.empty())
+            return entitiesPtrs;
+
+        cacheRetrieved(retrieveFromDb<EntityT>(missingIds), entitiesPtrs);
+        const auto getId = [](const auto& entityPtr) { return entityPtr->getId(); };
+        if(!std::ranges::is_sorted(entitiesPtrs, std::less{}, getId))
+            std::ranges::sort(entitiesPtrs, std::less{}, getId);
+        return entitiesPtrs;
+    }
+
+    template<typename EntityT, typename... Conditions>
+    requires (!(sizeof...(Conditions) == 1 && (std::same_as<std::remove_cvref_t<Conditions>, std::set<Id>> && ...)))
+    std::vector<EntityPtr<EntityT>> retrieve(Conditions&&... cond)
+    {
+        std::vector<EntityPtr<EntityT>> entitiesPtrs;
+        cacheRetrieved(retrieveFromDb<EntityT>(cond...), entitiesPtrs);
         return entitiesPtrs;
     }
 
@@ -66,19 +249,90 @@ public:
         return retrieve<EntityT>();
     }
 
+    //Keyset pagination over (sort column, ID), so that every page costs the same regardless of its position.
+    //Sort column has to be NOT NULL, as entities with NULL sort value never meet conditions of the next pages.
+    template<typename EntityT, typename OrderBy>
+    Page<EntityT, SortValueType<EntityT, OrderBy>> retrievePage(
+        const std::optional<PageKey<SortValueType<EntityT, OrderBy>>>& afterKey, std::size_t limit, OrderBy orderBy,
+        SortOrder order = SortOrder::Ascending)
+    {
+        Page<EntityT, SortValueType<EntityT, OrderBy>> page;
+        if(limit == 0)
+            return page;
+
+        //One entity more is read, so that the last page is known without another query returning nothing
+        auto entities = getImpl().template retrievePageImpl<EntityT>(afterKey, limit + 1, orderBy, order);
+        if(entities.size() > limit)
+        {
+            entities.pop_back();
+            //Key is taken from the DB state, as cached entities may have uncommitted changes
+            page.nextKey.emplace(std::invoke(orderBy, entities.back()), entities.back().getId());
+        }
+
+        if constexpr(WithFkEntity<EntityT>)
+            fetchFkEntities(entities);
+        cacheRetrieved(std::move(entities), page.entities);
+        return page;
+    }
+
+    //Only given columns are read, into tuples of their values, without creating or caching any entity.
+    //Values come from DB state, so uncommitted changes of cached entities aren't visible here.
+    template<typename EntityT, auto... Columns, typename... Conditions>
+    auto select(Conditions&&... conds)
+    {
+        static_assert(sizeof...(Columns) > 0, "At least one column has to be selected");
+        return getImpl().template selectImpl<EntityT, Columns...>(std::forward<Conditions>(conds)...);
+    }
+
+    //Every row is turned into RowT constructed from selected values, in order of the columns
+    template<typename RowT, typename EntityT, auto... Columns, typename... Conditions>
+    std::vector<RowT> selectAs(Conditions&&... conds)
+    {
+        auto tuples = select<EntityT, Columns...>(std::forward<Conditions>(conds)...);
+        std::vector<RowT> rows;
+        rows.reserve(tuples.size());
+        for(auto& tuple : tuples)
+            rows.push_back(std::make_from_tuple<RowT>(std::move(tuple)));
+        return rows;
+    }
+
+    //Entities are read from live statement and cached in batches, so only one batch is kept in memory at a time.
+    //Generator must not outlive the database.
+    template<typename EntityT, typename... Conditions>
+    Generator<EntityPtr<EntityT>> retrieveStream(Conditions... conds)
+    {
+        auto entities = getImpl().template streamImpl<EntityT>(conds...);
+        auto entityIt = entities.begin();
+        const auto entitiesEnd = entities.end();
+        while(entityIt != entitiesEnd)
+        {
+            std::vector<EntityT> batch;
+            batch.reserve(streamBatchSize);
+            for(; entityIt != entitiesEnd && batch.size() < streamBatchSize; ++entityIt)
+                batch.push_back(std::move(*entityIt));
+            if constexpr(WithFkEntity<EntityT>)
+                fetchFkEntities(batch);
+
+            std::vector<EntityPtr<EntityT>> entitiesPtrs;
+            cacheRetrieved(std::move(batch), entitiesPtrs);
+            for(auto& entityPtr : entitiesPtrs)
+                co_yield entityPtr;
+        }
+    }
+
     template<WithFkEntity EntityT>
     void commitChanges(EntityPtr<EntityT>& entity)
     { 
         assertEntityInCache(entity);
         entity->updateFkId();
-        getImpl().updateImpl(*entity);
+        update(entity);
     }
 
     template<typename EntityT>
     void commitChanges(const EntityPtr<EntityT>& entity)
     { 
         assertEntityInCache(entity);
-        getImpl().updateImpl(*entity);
+        update(entity);
     }
 
     template<typename EntityT>
@@ -88,12 +342,105 @@ public:
 
         auto& cache = getCache<EntityT>();
         EntityPtr<EntityT> invalidatedEntity(std::move(entity));
+        if(sessionDepth > 0)
+        {
+            auto& changes = getPendingChanges<EntityT>();
+            if(changes.isCreated(invalidatedEntity))
+                cache.erase(invalidatedEntity.get());
+            changes.addRemoved(std::move(invalidatedEntity));
+            return;
+        }
+
         getImpl().removeImpl(*invalidatedEntity);
         invalidatedEntity->invalidate();
-        cache.erase(invalidatedEntity);
+        cache.erase(invalidatedEntity.get());
+        notifyChanged<EntityT>(ChangeKind::Removed, invalidatedEntity->getId());
+    }
+
+    //Listeners are called on the writer thread once changes get committed, changes of a session are reported together.
+    //They may be added and removed on any thread, removal waits for notification in progress to finish,
+    //so listeners themselves mustn't add or remove any.
+    ListenerId addChangeListener(ChangeListener listener)
+    {
+        std::lock_guard lock(listenersMutex);
+        changeListeners.emplace_back(++lastListenerId, std::move(listener));
+        return lastListenerId;
+    }
+
+    void removeChangeListener(ListenerId id)
+    {
+        std::lock_guard lock(listenersMutex);
+        std::erase_if(changeListeners, [id](const auto& listener) { return listener.first == id; });
+    }
+
+    //In thread safe build only entities retrieved by the thread which set the policy get refreshed,
+    //other threads may be reading them just like any entity the writer changes
+    void setRefreshPolicy(RefreshPolicy policy)
+    {
+        refreshPolicy = policy;
+        refreshingThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    }
+
+    void setFkLoadingPolicy(FkLoadingPolicy policy)
+    {
+        fkLoadingPolicy = policy;
+    }
+
+    //Resolves all unresolved lazy handles from given range with a single query
+    template<std::ranges::forward_range Range>
+    void resolveLazy(Range&& lazyEntities)
+    {
+        using FkEntityT = typename std::remove_cvref_t<std::ranges::range_reference_t<Range>>::EntityType;
+        std::set<Id> ids;
+        for(const auto& lazyEntity : lazyEntities)
+        {
+            if(!lazyEntity.isResolved())
+                ids.insert(lazyEntity.getId());
+        }
+        if(ids.empty())
+            return;
+
+        //Retrieved entities are sorted by their IDs
+        auto entitiesPtrs = retrieve<FkEntityT>(ids);
+        for(auto& lazyEntity : lazyEntities)
+        {
+            if(lazyEntity.isResolved())
+                continue;
+
+            const auto entityPtrIt = std::ranges::lower_bound(entitiesPtrs, lazyEntity.getId(), {},
+                [](const auto& entityPtr) { return entityPtr->getId(); });
+            if(entityPtrIt == entitiesPtrs.end() || (*entityPtrIt)->getId() != lazyEntity.getId())
+                throw std::runtime_error("Foreign key entity not present in database");
+            lazyEntity.setResolved(*entityPtrIt);
+        }
+    }
+
+    template<typename Func>
+    void transaction(Func&& func)
+    {
+        //Nested calls join the outermost transaction, as SQLite doesn't support nesting them
+        if(transactionDepth > 0)
+        {
+            func();
+            return;
+        }
+
+        ++transactionDepth;
+        try
+        {
+            getImpl().transactionImpl(func);
+        }
+        catch(...)
+        {
+            --transactionDepth;
+            throw;
+        }
+        --transactionDepth;
     }
 
 private:
+    static constexpr std::size_t streamBatchSize = 256;
+
     template<typename T>
     T&& forward(T&& obj)
     {
@@ -121,33 +468,352 @@ private:
     void assertEntityInCache(const EntityPtr<EntityT>& entity)
     {
         auto& cache = getCache<EntityT>();
-        if(cache.find(entity) == cache.end())
+        if(!cache.contains(entity.get()))
             throw std::runtime_error("Entity not found in cache");
     }
 
+    template<typename EntityT>
+    EntityPtr<EntityT> insert(EntityPtr<EntityT>&& entity)
+    {
+        auto& cache = getCache<EntityT>();
+        if(sessionDepth > 0)
+        {
+            cache.stage(entity.get());
+            getPendingChanges<EntityT>().addCreated(entity);
+            return std::move(entity);
+        }
+
+        getImpl().insertImpl(*entity);
+        cache.insert(entity.get());
+        notifyChanged<EntityT>(ChangeKind::Created, entity->getId());
+        return std::move(entity);
+    }
+
+    template<typename EntityT>
+    std::vector<EntityPtr<EntityT>> insertMany(std::vector<EntityPtr<EntityT>>&& entities)
+    {
+        if(sessionDepth > 0)
+        {
+            for(auto& entity : entities)
+                entity = insert(std::move(entity));
+            return std::move(entities);
+        }
+
+        transaction([this, &entities] {
+            for(auto& entity : entities)
+                getImpl().insertImpl(*entity);
+        });
+
+        //Entities are cached only after the whole batch got committed
+        auto& cache = getCache<EntityT>();
+        for(const auto& entity : entities)
+            cache.insert(entity.get());
+
+        notifyListeners([&entities](Changes& changes) {
+            for(const auto& entity : entities)
+                changes.template add<EntityT>(ChangeKind::Created, entity->getId());
+        });
+        return std::move(entities);
+    }
+
+    template<typename EntityT>
+    EntityPtr<EntityT> cacheRetrieved(EntityT&& entity)
+    {
+        auto& cache = getCache<EntityT>();
+        auto entityPtr = cache.acquire(entity.getId());
+        if(!entityPtr)
+            return cache.insertOrAcquire(EntityPtr<EntityT>(cache.make(std::move(entity))));
+
+        //Entities with changes pending in a session are never refreshed, so that these changes don't get lost
+        if(mayRefreshCached() && !getPendingChanges<EntityT>().isUpdated(entity.getId()))
+            *entityPtr = std::move(entity);
+        return entityPtr;
+    }
+
+    bool mayRefreshCached() const
+    {
+        if(internal::threadSafe && refreshingThread.load(std::memory_order_relaxed) != std::this_thread::get_id())
+            return false;
+        return refreshPolicy == RefreshPolicy::RefreshFromDb;
+    }
+
+    template<typename EntityT>
+    void cacheRetrieved(std::vector<EntityT>&& entities, std::vector<EntityPtr<EntityT>>& entitiesPtrs)
+    {
+        entitiesPtrs.reserve(entitiesPtrs.size() + entities.size());
+        for(auto& entity : entities)
+            entitiesPtrs.push_back(cacheRetrieved(std::move(entity)));
+    }
+
+    template<typename EntityT>
+    void update(const EntityPtr<EntityT>& entity)
+    {
+        if(sessionDepth > 0)
+        {
+            getPendingChanges<EntityT>().addUpdated(entity);
+            return;
+        }
+
+        getImpl().updateImpl(*entity);
+        notifyChanged<EntityT>(ChangeKind::Updated, entity->getId());
+    }
+
+    template<typename EntityT>
+    void notifyChanged(ChangeKind kind, Id id)
+    {
+        notifyListeners([kind, id](Changes& changes) { changes.template add<EntityT>(kind, id); });
+    }
+
+    //Changes are collected only if there's any listener to report them to
+    template<typename CollectChanges>
+    void notifyListeners(CollectChanges&& collectChanges)
+    {
+        std::lock_guard lock(listenersMutex);
+        if(changeListeners.empty())
+            return;
+
+        Changes changes;
+        collectChanges(changes);
+        if(changes.empty())
+            return;
+
+        for(const auto& [id, listener] : changeListeners)
+            listener(changes);
+    }
+
+    template<typename EntityT>
+    static void updateFkIdBeforeFlush(EntityT& entity)
+    {
+        //FK entities could have been created within the same session, so their IDs are known only now
+        if constexpr(requires { entity.updateFkId(); })
+            entity.updateFkId();
+    }
+
+    void flushPendingChanges()
+    {
+        auto changes = std::exchange(pendingChanges, {});
+        try
+        {
+            transaction([this, &changes] {
+                (flushCreated(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+                (flushUpdated(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+                [this, &changes]<std::size_t... I>(std::index_sequence<I...>) {
+                    //Dependent entities are removed before the ones they refer to
+                    (flushRemoved(std::get<sizeof...(I) - 1 - I>(changes)), ...);
+                }(std::index_sequence_for<Entities...>{});
+            });
+        }
+        catch(...)
+        {
+            //Rolled back changes are discarded the same way as the ones of session which wasn't committed
+            (invalidateCreated(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+            (evictUpdated(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+            throw;
+        }
+
+        (cacheFlushed(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+
+        notifyListeners([&changes](Changes& flushedChanges) {
+            (collectFlushed(std::get<internal::PendingChanges<Entities>>(changes), flushedChanges), ...);
+        });
+    }
+
+    //Updated entities are evicted, so that they get retrieved again in their committed state.
+    //Handles still held keep pointing to the edited ones, which can't be committed anymore.
+    void discardPendingChanges()
+    {
+        auto changes = std::exchange(pendingChanges, {});
+        (invalidateCreated(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+        (evictUpdated(std::get<internal::PendingChanges<Entities>>(changes)), ...);
+    }
+
+    template<typename EntityT>
+    void flushCreated(internal::PendingChanges<EntityT>& changes)
+    {
+        for(auto& entity : changes.created)
+        {
+            updateFkIdBeforeFlush(*entity);
+            getImpl().insertImpl(*entity);
+        }
+    }
+
+    template<typename EntityT>
+    void flushUpdated(internal::PendingChanges<EntityT>& changes)
+    {
+        for(const auto& entity : changes.updated)
+        {
+            updateFkIdBeforeFlush(*entity);
+            getImpl().updateImpl(*entity);
+        }
+    }
+
+    template<typename EntityT>
+    void flushRemoved(internal::PendingChanges<EntityT>& changes)
+    {
+        for(const auto& entity : changes.removed)
+            getImpl().removeImpl(*entity);
+    }
+
+    template<typename EntityT>
+    void cacheFlushed(internal::PendingChanges<EntityT>& changes)
+    {
+        auto& cache = getCache<EntityT>();
+        for(const auto& entity : changes.created)
+            cache.insert(entity.get());
+        for(const auto& entity : changes.removed)
+        {
+            entity->invalidate();
+            cache.erase(entity.get());
+        }
+    }
+
+    template<typename EntityT>
+    static void collectFlushed(const internal::PendingChanges<EntityT>& pending, Changes& changes)
+    {
+        for(const auto& entity : pending.created)
+            changes.template add<EntityT>(ChangeKind::Created, entity->getId());
+        for(const auto& entity : pending.updated)
+            changes.template add<EntityT>(ChangeKind::Updated, entity->getId());
+        for(const auto& entity : pending.removed)
+            changes.template add<EntityT>(ChangeKind::Removed, entity->getId());
+    }
+
+    template<typename EntityT>
+    void invalidateCreated(internal::PendingChanges<EntityT>& changes)
+    {
+        auto& cache = getCache<EntityT>();
+        for(const auto& entity : changes.created)
+        {
+            cache.erase(entity.get());
+            entity->invalidate();
+        }
+    }
+
+    template<typename EntityT>
+    void evictUpdated(internal::PendingChanges<EntityT>& changes)
+    {
+        auto& cache = getCache<EntityT>();
+        for(const auto& entity : changes.updated)
+            cache.erase(entity.get());
+    }
+
+    template<WithFkEntity EntityT>
+    bool loadFkLazily() const
+    {
+        return WithLazyFkEntity<EntityT> && fkLoadingPolicy == FkLoadingPolicy::Lazy;
+    }
+
+    template<WithLazyFkEntity EntityT>
+    void setLazyFkEntity(EntityT& entity)
+    {
+        using FkEntityT = typename EntityT::FkEntity;
+        entity.setFkEntity(LazyEntityPtr<const FkEntityT>(entity.getFkId(), getResolver<FkEntityT>()));
+    }
+
+    template<typename EntityT>
+    const internal::EntityResolver<EntityT>& getResolver()
+    {
+        //Created on first use, so that retrieval by ID gets instantiated only for entities referenced lazily
+        std::lock_guard lock(resolversMutex);
+        auto& resolver = std::get<std::optional<internal::EntityResolver<EntityT>>>(resolvers);
+        if(!resolver)
+        {
+            resolver.emplace(this, [](void* database, Id id) {
+                return static_cast<Database*>(database)->template retrieve<EntityT>(id);
+            });
+        }
+        return *resolver;
+    }
+
     template<typename EntityT>
     void fetchFkEntities(std::vector<EntityT>& entities)
     {
+        if constexpr(WithLazyFkEntity<EntityT>)
+        {
+            if(loadFkLazily<EntityT>())
+            {
+                for(auto& entity : entities)
+                    setLazyFkEntity(entity);
+                return;
+            }
+        }
+
         std::set<Id> fkIds;
         std::transform(entities.begin(), entities.end(), std::inserter(fkIds, fkIds.end()),
             [](const auto& entity) { return entity.getFkId(); });
 
         auto fkEntitiesPtrs = retrieve<typename EntityT::FkEntity>(fkIds);
+        std::unordered_map<Id, const EntityPtr<typename EntityT::FkEntity>*> fkEntitiesById;
+        fkEntitiesById.reserve(fkEntitiesPtrs.size());
+        for(const auto& fkEntityPtr : fkEntitiesPtrs)
+            fkEntitiesById.emplace(fkEntityPtr->getId(), &fkEntityPtr);
+
         for(auto& entity : entities)
         {
-            const auto fkEntityPtrIt = std::find_if(
-                fkEntitiesPtrs.begin(), fkEntitiesPtrs.end(),
-                [&entity](const auto& fkp) { return fkp->getId() == entity.getFkId(); });
-            if(fkEntityPtrIt == fkEntitiesPtrs.end() )
+            const auto fkEntityPtrIt = fkEntitiesById.find(entity.getFkId());
+            if(fkEntityPtrIt == fkEntitiesById.end())
                 throw std::runtime_error("Foreign key entity not present in database");
-            entity.setFkEntity(*fkEntityPtrIt);
+            entity.setFkEntity(*fkEntityPtrIt->second);
+        }
+    }
+
+    template<typename EntityT, typename... Conditions>
+    static constexpr bool canJoinFkEntities()
+    {
+        if constexpr(WithFkEntity<EntityT>)
+            return requires(DbImpl& impl, Conditions&&... conds) { impl.template retrieveJoinedImpl<EntityT>(conds...); };
+        else
+            return false;
+    }
+
+    //Every row holds an entity followed by its chain of FK entities, deeper ones are cached first
+    template<std::size_t Level, typename Rows>
+    void linkJoinedFkEntities(Rows& rows)
+    {
+        using EntityT = std::tuple_element_t<Level, std::ranges::range_value_t<Rows>>;
+        if constexpr(WithFkEntity<EntityT>)
+        {
+            linkJoinedFkEntities<Level + 1>(rows);
+
+            //FK entities repeat across rows, each of them is cached only once
+            std::unordered_map<Id, EntityPtr<typename EntityT::FkEntity>> fkEntitiesById;
+            for(auto& row : rows)
+            {
+                auto& entity = std::get<Level>(row);
+                auto [fkEntityPtrIt, inserted] = fkEntitiesById.try_emplace(entity.getFkId());
+                if(inserted)
+                    fkEntityPtrIt->second = cacheRetrieved(std::move(std::get<Level + 1>(row)));
+                entity.setFkEntity(fkEntityPtrIt->second);
+            }
         }
     }
 
+    template<typename EntityT, typename... Conditions>
+    std::vector<EntityT> retrieveJoinedFromDb(Conditions&&... conds)
+    {
+        auto rows = getImpl().template retrieveJoinedImpl<EntityT>(forward(conds)...);
+        linkJoinedFkEntities<0>(rows);
+
+        std::vector<EntityT> entities;
+        entities.reserve(rows.size());
+        for(auto& row : rows)
+            entities.push_back(std::move(std::get<0>(row)));
+        return entities;
+    }
+
     template<WithFkEntity EntityT>
     EntityT retrieveFromDb(Id id)
     {
         auto entity = getImpl().template retrieveImpl<EntityT>(id);
+        if constexpr(WithLazyFkEntity<EntityT>)
+        {
+            if(loadFkLazily<EntityT>())
+            {
+                setLazyFkEntity(entity);
+                return entity;
+            }
+        }
+
         auto fkEntityPtr = retrieve<typename EntityT::FkEntity>(entity.getFkId());
         entity.setFkEntity(fkEntityPtr);
         return entity;
@@ -162,6 +828,12 @@ private:
     template<typename EntityT, typename ConditionT>
     std::vector<EntityT> retrieveFromDb(ConditionT&& cond)
     {
+        if constexpr(canJoinFkEntities<EntityT, decltype(forward(cond))>())
+        {
+            if(fkLoadingPolicy == FkLoadingPolicy::Joined)
+                return retrieveJoinedFromDb<EntityT>(cond);
+        }
+
         auto entities = getImpl().template retrieveImpl<EntityT>(forward(cond));
         if constexpr(WithFkEntity<EntityT>)
             fetchFkEntities(entities);
@@ -171,18 +843,47 @@ private:
     template<typename EntityT>
     std::vector<EntityT> retrieveFromDb()
     {
+        if constexpr(canJoinFkEntities<EntityT>())
+        {
+            if(fkLoadingPolicy == FkLoadingPolicy::Joined)
+                return retrieveJoinedFromDb<EntityT>();
+        }
+
         auto entities = getImpl().template retrieveImpl<EntityT>();
         if constexpr(WithFkEntity<EntityT>)
             fetchFkEntities(entities);
         return entities;
     }
 
+    //All caches have the same arena set, so either the first one throws or none does
+    void setArena(std::pmr::memory_resource* arena)
+    {
+        (getCache<Entities>().setArena(arena), ...);
+    }
+
     template<typename EntityT>
     internal::EntityCache<EntityT>& getCache()
     {
         return std::get<internal::EntityCache<EntityT>>(caches);
     }
 
+    template<typename EntityT>
+    internal::PendingChanges<EntityT>& getPendingChanges()
+    {
+        return std::get<internal::PendingChanges<EntityT>>(pendingChanges);
+    }
+
     std::tuple<internal::EntityCache<Entities>...> caches;
+    std::tuple<internal::PendingChanges<Entities>...> pendingChanges;
+    int transactionDepth = 0;
+    int sessionDepth = 0;
+    RefreshPolicy refreshPolicy = RefreshPolicy::KeepCached;
+    std::atomic<std::thread::id> refreshingThread;
+    FkLoadingPolicy fkLoadingPolicy = FkLoadingPolicy::Eager;
+    std::tuple<std::optional<internal::EntityResolver<Entities>>...> resolvers;
+    internal::Mutex resolversMutex;
+    std::vector<std::pair<ListenerId, ChangeListener>> changeListeners;
+    ListenerId lastListenerId = 0;
+    internal::Mutex listenersMutex;
 };
 }
\ No newline at end of file
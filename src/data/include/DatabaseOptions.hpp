@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+struct sqlite3;
+
+namespace FG::data
+{
+//SQLite tuning applied to every connection opened by the database.
+//Values left unset keep SQLite defaults.
+//In-memory database gets them too, but SQLite keeps its journal in memory regardless of journalMode
+//and it has no read-only connections.
+struct DatabaseOptions
+{
+    enum class JournalMode
+    {
+        Delete,
+        Truncate,
+        Wal,
+        Memory
+    };
+
+    enum class Synchronous
+    {
+        Off,
+        Normal,
+        Full,
+        Extra
+    };
+
+    enum class TempStore
+    {
+        Default,
+        File,
+        Memory
+    };
+
+    std::optional<JournalMode> journalMode;
+    std::optional<Synchronous> synchronous;
+    std::optional<int> cacheSizeKiB;
+    std::optional<std::int64_t> mmapSizeBytes;
+    std::optional<TempStore> tempStore;
+    std::chrono::milliseconds busyTimeout{0};
+    //Read-only connections serving other threads than the writer in thread safe build, 0 means one per core.
+    //Unless journal is in WAL mode, they wait for writer's commits only as long as busyTimeout allows.
+    std::size_t maxReadConnections = 0;
+
+    //Every committed transaction survives power loss, readers don't block writer
+    static DatabaseOptions durable()
+    {
+        return {
+            .journalMode = JournalMode::Wal,
+            .synchronous = Synchronous::Full,
+            .busyTimeout = std::chrono::seconds(5)
+        };
+    }
+
+    //Last transactions may be lost on power loss (never on application crash), database stays consistent
+    static DatabaseOptions fast()
+    {
+        return {
+            .journalMode = JournalMode::Wal,
+            .synchronous = Synchronous::Normal,
+            .cacheSizeKiB = 64 * 1024,
+            .mmapSizeBytes = 256ll * 1024 * 1024,
+            .tempStore = TempStore::Memory,
+            .busyTimeout = std::chrono::seconds(5)
+        };
+    }
+};
+
+namespace internal
+{
+void applyDatabaseOptions(sqlite3* db, const DatabaseOptions& options);
+}
+}
\ No newline at end of file
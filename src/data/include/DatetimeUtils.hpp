@@ -1,6 +1,9 @@
 #pragma once
 
 #include <chrono>
+#include <compare>
+#include <cstdint>
+#include <span>
 #include <string_view>
 
 namespace FG::data
@@ -8,11 +11,60 @@ namespace FG::data
 using Datetime = std::chrono::time_point<std::chrono::system_clock>;
 using Timestamp = Datetime::duration::rep;
 
+//Day-resolution date kept as number of days since Unix epoch, for dates where time of day doesn't matter
+class Date
+{
+public:
+    using rep = std::int32_t;
+
+    constexpr Date() = default;
+
+    constexpr Date(std::chrono::sys_days day) : daysSinceEpoch(static_cast<rep>(day.time_since_epoch().count()))
+    {}
+
+    constexpr explicit Date(std::chrono::year_month_day ymd) : Date(std::chrono::sys_days(ymd))
+    {}
+
+    constexpr explicit Date(rep days) : daysSinceEpoch(days)
+    {}
+
+    static constexpr Date fromDatetime(const Datetime& dt)
+    {
+        return Date(std::chrono::floor<std::chrono::days>(dt));
+    }
+
+    constexpr rep getDaysSinceEpoch() const
+    {
+        return daysSinceEpoch;
+    }
+
+    constexpr std::chrono::sys_days toSysDays() const
+    {
+        return std::chrono::sys_days(std::chrono::days(daysSinceEpoch));
+    }
+
+    Datetime toDatetime() const
+    {
+        return Datetime(toSysDays());
+    }
+
+    constexpr auto operator<=>(const Date&) const = default;
+
+private:
+    rep daysSinceEpoch = 0;
+};
+
 Timestamp datetimeToUnixTimestamp(const Datetime& dt);
 
 Datetime unixTimestampToDatetime(const Timestamp ts);
 
+//Accepts both dates and full ISO-8601 date and time (optionally with UTC offset)
 Timestamp isoDateToTimestamp(std::string_view dtStr);
 
+void isoDatesToTimestamps(std::span<const std::string_view> dtStrs, std::span<Timestamp> timestamps);
+
 Datetime parseIsoDate(std::string_view dtStr);
+
+//Time of day, if present, is truncated
+Date isoDateToDate(std::string_view dtStr);
 }
\ No newline at end of file
@@ -6,12 +6,15 @@
 #include <utility>
 
 #include "DatetimeUtils.hpp"
+#include "EntityControlBlock.hpp"
 #include "EntityPtr.hpp"
+#include "EntityUtils.hpp"
+#include "LazyEntityPtr.hpp"
 
 namespace FG::data
 {
 template<class SchemaT>
-class DbEntity : public SchemaT
+class DbEntity : public SchemaT, public internal::EntityControlBlock
 {
 public:
     using DbEntityType = DbEntity;
@@ -109,48 +112,48 @@ struct ProductDescription : public DbEntity<ProductDescriptionSchema>
         : DbEntityType(cat, std::move(data)), category(cat)
     {}
 
-    void setFkEntity(EntityPtr<const ProductCategory> newCategory)
+    void setFkEntity(LazyEntityPtr<const ProductCategory> newCategory)
     {
-        category = newCategory;
-        setFkId(newCategory->getId());
+        category = std::move(newCategory);
+        setFkId(category.getId());
     }
 
     void updateFkId()
     {
-        setFkId(category->getId());
+        setFkId(category.getId());
     }
 
-    EntityPtr<const ProductCategory> category;
+    LazyEntityPtr<const ProductCategory> category;
 };
 
 struct ProductInstanceSchema
 {
     using FkEntity = ProductDescription;
 
-    Datetime purchaseDate;
-    Datetime expirationDate;
+    Date purchaseDate;
+    Date expirationDate;
     Nullable<unsigned int> daysToExpireWhenOpened;
     bool isOpen;
     bool isConsumed;
 
     const Timestamp getPurchaseDateTimestamp() const
     {
-        return datetimeToUnixTimestamp(purchaseDate);
+        return datetimeToUnixTimestamp(purchaseDate.toDatetime());
     }
 
     void setPurchaseDateTimestamp(Timestamp newDate)
     {
-        purchaseDate = unixTimestampToDatetime(newDate);
+        purchaseDate = Date::fromDatetime(unixTimestampToDatetime(newDate));
     }
 
     const Timestamp getExpirationDateTimestamp() const
     {
-        return datetimeToUnixTimestamp(expirationDate);
+        return datetimeToUnixTimestamp(expirationDate.toDatetime());
     }
 
     void setExpirationDateTimestamp(Timestamp newDate)
     {
-        expirationDate = unixTimestampToDatetime(newDate);
+        expirationDate = Date::fromDatetime(unixTimestampToDatetime(newDate));
     }
 };
 
@@ -166,17 +169,17 @@ struct ProductInstance : public DbEntity<ProductInstanceSchema>
         : DbEntityType(desc, std::move(data)), description(desc)
     {}
 
-    void setFkEntity(EntityPtr<const ProductDescription> newDescription)
+    void setFkEntity(LazyEntityPtr<const ProductDescription> newDescription)
     {
-        description = newDescription;
-        setFkId(newDescription->getId());
+        description = std::move(newDescription);
+        setFkId(description.getId());
     }
 
     void updateFkId()
     {
-        setFkId(description->getId());
+        setFkId(description.getId());
     }
 
-    EntityPtr<const ProductDescription> description;
+    LazyEntityPtr<const ProductDescription> description;
 };
 }
\ No newline at end of file
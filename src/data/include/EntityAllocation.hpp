@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace FG::data
+{
+struct AllocationStats
+{
+    std::size_t allocatedEntities = 0;
+    std::size_t releasedEntities = 0;
+    std::size_t arenaAllocatedEntities = 0;
+    std::size_t upstreamAllocations = 0;
+    std::size_t upstreamBytes = 0;
+};
+
+namespace internal
+{
+//Passes allocations through to upstream resource, counting what actually reached it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(AllocationStats& allocationStats,
+                              std::pmr::memory_resource* upstreamResource = std::pmr::new_delete_resource())
+        : stats(allocationStats), upstream(upstreamResource)
+    {}
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        auto* memory = upstream->allocate(bytes, alignment);
+        ++stats.upstreamAllocations;
+        stats.upstreamBytes += bytes;
+        return memory;
+    }
+
+    void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+    {
+        upstream->deallocate(memory, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    AllocationStats& stats;
+    std::pmr::memory_resource* upstream;
+};
+}
+}
\ No newline at end of file
@@ -1,38 +1,510 @@
 #pragma once
 
-#include <memory>
-#include <set>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "EntityAllocation.hpp"
+#include "EntityControlBlock.hpp"
+#include "EntityPtr.hpp"
 #include "EntityUtils.hpp"
+#include "Synchronization.hpp"
 
 namespace FG::data
 {
 namespace internal
 {
+//Open addressing hash map with linear probing, keyed by entity ID.
+//Entities which don't have their ID assigned yet are kept in separate staging area.
+//Cache owns all entities it made, and destroys them once their last EntityPtr is gone.
+//Entities are allocated from per-type pool, unless arena is set for short-lived entities.
+//Arena entities are mapped apart from the others, only for the thread which set the arena and until it's unset.
+//In thread safe build the map is split into shards locked independently, so that lookups on different
+//threads rarely contend, and entities may be released on any thread. Iteration is never synchronized.
 template<typename EntityT>
-struct EntityComparator
+class EntityCache
 {
-    using is_transparent = std::true_type;
+public:
+    using value_type = EntityT*;
 
-    bool operator()(const Id& lhs, const std::shared_ptr<EntityT>& rhs) const
+    class iterator
     {
-        return lhs < rhs->getId();
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = EntityCache::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        iterator() = default;
+
+        iterator(const EntityCache* c, std::size_t shardIdx, std::size_t idx) : cache(c), shard(shardIdx), slot(idx)
+        {
+            skipEmptySlots();
+        }
+
+        reference operator*() const
+        {
+            return cache->shards[shard].values[slot];
+        }
+
+        iterator& operator++()
+        {
+            ++slot;
+            skipEmptySlots();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const iterator&) const = default;
+
+    private:
+        friend class EntityCache;
+
+        void skipEmptySlots()
+        {
+            for(; shard < shardsCount; ++shard, slot = 0)
+            {
+                const auto& keys = cache->shards[shard].keys;
+                while(slot < keys.size() && keys[slot] == uninitializedId)
+                    ++slot;
+                if(slot < keys.size())
+                    return;
+            }
+        }
+
+        const EntityCache* cache = nullptr;
+        std::size_t shard = 0;
+        std::size_t slot = 0;
+    };
+
+    EntityCache() : owner(new Owner(this))
+    {}
+
+    EntityCache(const EntityCache&) = delete;
+    EntityCache& operator=(const EntityCache&) = delete;
+
+    ~EntityCache()
+    {
+        //Entities still referenced from outside outlive the cache, last of them cleans up the owner
+        bool noLiveEntities;
+        {
+            std::unique_lock cacheLock(owner->cacheMutex);
+            std::lock_guard lock(owner->poolMutex);
+            owner->cache = nullptr;
+            noLiveEntities = owner->liveEntitiesCount() == 0;
+        }
+        if(noLiveEntities)
+            delete owner;
     }
 
-    bool operator()(const std::shared_ptr<EntityT>& lhs, const Id& rhs) const
+    template<typename... Args>
+    EntityT* make(Args&&... args)
     {
-        return lhs->getId() < rhs;
+        auto* currentArena = getArena();
+        auto* resource = currentArena ? currentArena : &owner->pool;
+        std::lock_guard lock(owner->poolMutex);
+        auto* entity = std::pmr::polymorphic_allocator<>(resource).template new_object<EntityT>(std::forward<Args>(args)...);
+        entity->setOwner(owner, resource);
+        ++owner->stats.allocatedEntities;
+        if(currentArena)
+            ++owner->stats.arenaAllocatedEntities;
+        return entity;
     }
 
-    bool operator()(const std::shared_ptr<EntityT>& lhs, const std::shared_ptr<EntityT>& rhs) const
+    //Arena has to outlive all entities allocated while it was set.
+    //Entities of unset arena stay alive as long as they are referenced, but can't be found in cache anymore.
+    //Arena can't be replaced by another one, entities of the first one would be lost for the rest of its use.
+    void setArena(std::pmr::memory_resource* newArena)
     {
-        if(lhs->getId() == uninitializedId) return false;
-        if(rhs->getId() == uninitializedId) return true;
-        return lhs->getId() < rhs->getId();
+        std::lock_guard lock(arenaMutex);
+        if(newArena && arena.load(std::memory_order_relaxed))
+            throw std::logic_error("Arena is already set, it has to be unset first");
+
+        arenaEntities.clear();
+        arenaThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        arena.store(newArena, std::memory_order_release);
     }
-};
 
-template<typename EntityT>
-using EntityCache = std::set<std::shared_ptr<EntityT>, EntityComparator<EntityT>>;
+    const AllocationStats& getAllocationStats() const
+    {
+        return owner->stats;
+    }
+
+    iterator begin() const
+    {
+        return {this, 0, 0};
+    }
+
+    iterator end() const
+    {
+        return {this, shardsCount, 0};
+    }
+
+    std::size_t size() const
+    {
+        std::size_t count = 0;
+        for(const auto& shard : shards)
+        {
+            std::shared_lock lock(shard.mutex);
+            count += shard.count;
+        }
+        return count;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    //Returned iterator may be invalidated by other threads, acquire() is the safe way to look entities up.
+    //Entities allocated from arena are never found here.
+    iterator find(Id id) const
+    {
+        const auto shardIdx = shardIndex(id);
+        const auto& shard = shards[shardIdx];
+        std::shared_lock lock(shard.mutex);
+        const auto slot = shard.findSlot(id);
+        return slot == notFound ? end() : iterator(this, shardIdx, slot);
+    }
+
+    //Empty EntityPtr is returned also for entity which is being released at the moment
+    EntityPtr<EntityT> acquire(Id id) const
+    {
+        if(auto entity = acquireShared(id))
+            return entity;
+        return getArena() ? acquireFromArena(id) : nullptr;
+    }
+
+    bool contains(const EntityT* entity) const
+    {
+        if(isFromArena(entity))
+        {
+            std::lock_guard lock(arenaMutex);
+            const auto entityIt = arenaEntities.find(entity->getId());
+            if(entityIt != arenaEntities.end() && entityIt->second == entity)
+                return true;
+        }
+
+        {
+            const auto& shard = shards[shardIndex(entity->getId())];
+            std::shared_lock lock(shard.mutex);
+            const auto slot = shard.findSlot(entity->getId());
+            if(slot != notFound && shard.values[slot] == entity)
+                return true;
+        }
+
+        std::lock_guard lock(stagedMutex);
+        return staged.contains(entity);
+    }
+
+    //Entity without ID would take the empty slot marker as its key, so it's staged instead
+    std::pair<iterator, bool> insert(value_type entity)
+    {
+        if(entity->getId() == uninitializedId)
+        {
+            stage(entity);
+            return {end(), true};
+        }
+        //No iterator points to arena entities, as they are kept apart from the map
+        if(isFromArena(entity))
+            return {end(), insertToArena(entity)};
+
+        unstage(entity);
+        const auto shardIdx = shardIndex(entity->getId());
+        auto& shard = shards[shardIdx];
+        std::unique_lock lock(shard.mutex);
+        auto [slot, inserted] = shard.insert(entity);
+        return {iterator(this, shardIdx, slot), inserted};
+    }
+
+    //Entity already cached under the same ID is returned instead of the given one, if there's any
+    EntityPtr<EntityT> insertOrAcquire(EntityPtr<EntityT> entity)
+    {
+        if(entity->getId() == uninitializedId)
+        {
+            stage(entity.get());
+            return entity;
+        }
+        if(isFromArena(entity.get()))
+        {
+            //Entity could have been cached by other thread, outside of the arena
+            if(auto cached = acquireShared(entity->getId()))
+                return cached;
+            if(auto cached = acquireFromArena(entity->getId()))
+                return cached;
+            insertToArena(entity.get());
+            return entity;
+        }
+
+        unstage(entity.get());
+        EntityPtr<EntityT> cached;
+        {
+            auto& shard = shards[shardIndex(entity->getId())];
+            std::unique_lock lock(shard.mutex);
+            auto [slot, inserted] = shard.insert(entity.get());
+            if(!inserted && shard.values[slot]->tryAcquireReference())
+                cached = EntityPtr<EntityT>(shard.values[slot], AdoptReference{});
+        }
+        //Given entity is dropped only here, as releasing it locks the shard again
+        if(cached)
+            return cached;
+        return entity;
+    }
+
+    void stage(value_type entity)
+    {
+        std::lock_guard lock(stagedMutex);
+        staged.insert(entity);
+    }
+
+    void erase(const EntityT* entity)
+    {
+        if(isFromArena(entity))
+        {
+            std::lock_guard lock(arenaMutex);
+            const auto entityIt = arenaEntities.find(entity->getId());
+            if(entityIt != arenaEntities.end() && entityIt->second == entity)
+                arenaEntities.erase(entityIt);
+        }
+        else
+        {
+            auto& shard = shards[shardIndex(entity->getId())];
+            std::unique_lock lock(shard.mutex);
+            const auto slot = shard.findSlot(entity->getId());
+            if(slot != notFound && shard.values[slot] == entity)
+            {
+                shard.eraseSlot(slot);
+                return;
+            }
+        }
+        unstage(entity);
+    }
+
+private:
+    static constexpr std::size_t initialCapacity = 16;
+    static constexpr std::size_t shardsCount = threadSafe ? 16 : 1;
+    static constexpr std::size_t notFound = static_cast<std::size_t>(-1);
+
+    struct Owner final : public EntityOwner
+    {
+        explicit Owner(EntityCache* c) : cache(c)
+        {}
+
+        void release(const EntityControlBlock& entityBlock) override
+        {
+            auto* entity = const_cast<EntityT*>(static_cast<const EntityT*>(&entityBlock));
+            {
+                //Keeps the cache from being destroyed until entity is erased from it
+                std::shared_lock cacheLock(cacheMutex);
+                if(auto* currentCache = cache.load(std::memory_order_acquire))
+                    currentCache->erase(entity);
+            }
+
+            bool destroyOwner;
+            {
+                std::lock_guard lock(poolMutex);
+                std::pmr::polymorphic_allocator<>(entity->getMemoryResource()).delete_object(entity);
+                ++stats.releasedEntities;
+                destroyOwner = liveEntitiesCount() == 0 && !cache.load(std::memory_order_relaxed);
+            }
+            if(destroyOwner)
+                delete this;
+        }
+
+        std::size_t liveEntitiesCount() const
+        {
+            return stats.allocatedEntities - stats.releasedEntities;
+        }
+
+        std::atomic<EntityCache*> cache;
+        SharedMutex cacheMutex;
+        Mutex poolMutex;
+        AllocationStats stats;
+        CountingResource upstream{stats};
+        std::pmr::unsynchronized_pool_resource pool{&upstream};
+    };
+
+    struct Shard
+    {
+        std::size_t homeSlot(Id id) const
+        {
+            //Fibonacci hashing spreads sequential IDs evenly over the table
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(id) * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        std::size_t findSlot(Id id) const
+        {
+            if(count == 0 || id == uninitializedId)
+                return notFound;
+
+            for(auto slot = homeSlot(id); keys[slot] != uninitializedId; slot = (slot + 1) & mask)
+            {
+                if(keys[slot] == id)
+                    return slot;
+            }
+            return notFound;
+        }
+
+        //Entity whose last reference is already gone gets replaced, its owner won't find it here anymore
+        std::pair<std::size_t, bool> insert(value_type entity)
+        {
+            const auto id = entity->getId();
+            assert(id != uninitializedId);
+            if((count + 1) * 4 > keys.size() * 3)
+                rehash(keys.empty() ? initialCapacity : keys.size() * 2);
+
+            auto slot = homeSlot(id);
+            for(; keys[slot] != uninitializedId; slot = (slot + 1) & mask)
+            {
+                if(keys[slot] != id)
+                    continue;
+
+                if(values[slot] == entity || values[slot]->getReferencesCount() > 0)
+                    return {slot, false};
+                values[slot] = entity;
+                return {slot, true};
+            }
+
+            keys[slot] = id;
+            values[slot] = entity;
+            ++count;
+            return {slot, true};
+        }
+
+        void rehash(std::size_t newCapacity)
+        {
+            auto oldKeys = std::exchange(keys, std::vector<Id>(newCapacity, uninitializedId));
+            auto oldValues = std::exchange(values, std::vector<value_type>(newCapacity));
+            mask = newCapacity - 1;
+            shift = 64 - std::countr_zero(newCapacity);
+            for(std::size_t i = 0; i < oldKeys.size(); ++i)
+            {
+                if(oldKeys[i] == uninitializedId)
+                    continue;
+
+                auto slot = homeSlot(oldKeys[i]);
+                while(keys[slot] != uninitializedId)
+                    slot = (slot + 1) & mask;
+                keys[slot] = oldKeys[i];
+                values[slot] = oldValues[i];
+            }
+        }
+
+        void eraseSlot(std::size_t slot)
+        {
+            //Backward shift deletion keeps probe sequences intact without tombstones
+            for(auto next = (slot + 1) & mask; keys[next] != uninitializedId; next = (next + 1) & mask)
+            {
+                const auto home = homeSlot(keys[next]);
+                const bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+                if(stays)
+                    continue;
+
+                keys[slot] = keys[next];
+                values[slot] = values[next];
+                slot = next;
+            }
+
+            keys[slot] = uninitializedId;
+            values[slot] = nullptr;
+            --count;
+        }
+
+        mutable SharedMutex mutex;
+        std::vector<Id> keys;
+        std::vector<value_type> values;
+        std::size_t count = 0;
+        std::size_t mask = 0;
+        int shift = 64;
+    };
+
+    static std::size_t shardIndex(Id id)
+    {
+        return static_cast<std::size_t>(id) % shardsCount;
+    }
+
+    void unstage(const EntityT* entity)
+    {
+        std::lock_guard lock(stagedMutex);
+        if(!staged.empty())
+            staged.erase(entity);
+    }
+
+    EntityPtr<EntityT> acquireShared(Id id) const
+    {
+        const auto& shard = shards[shardIndex(id)];
+        std::shared_lock lock(shard.mutex);
+        const auto slot = shard.findSlot(id);
+        if(slot == notFound || !shard.values[slot]->tryAcquireReference())
+            return nullptr;
+        return EntityPtr<EntityT>(shard.values[slot], AdoptReference{});
+    }
+
+    EntityPtr<EntityT> acquireFromArena(Id id) const
+    {
+        std::lock_guard lock(arenaMutex);
+        const auto entityIt = arenaEntities.find(id);
+        if(entityIt == arenaEntities.end() || !entityIt->second->tryAcquireReference())
+            return nullptr;
+        return EntityPtr<EntityT>(entityIt->second, AdoptReference{});
+    }
+
+    //Entity of arena which was already unset is left out of cache, so that it's not found after arena's scope ended
+    bool insertToArena(EntityT* entity)
+    {
+        unstage(entity);
+        if(entity->getMemoryResource() != getArena())
+            return false;
+
+        std::lock_guard lock(arenaMutex);
+        auto [entityIt, inserted] = arenaEntities.try_emplace(entity->getId(), entity);
+        if(inserted || entityIt->second == entity || entityIt->second->getReferencesCount() > 0)
+            return inserted;
+        entityIt->second = entity;
+        return true;
+    }
+
+    bool isFromArena(const EntityT* entity) const
+    {
+        return entity->getMemoryResource() != &owner->pool;
+    }
+
+    //Arena serves only the thread which set it, entities made on other threads meanwhile come from the pool
+    std::pmr::memory_resource* getArena() const
+    {
+        auto* currentArena = arena.load(std::memory_order_acquire);
+        if(threadSafe && currentArena && arenaThread.load(std::memory_order_relaxed) != std::this_thread::get_id())
+            return nullptr;
+        return currentArena;
+    }
+
+    Owner* owner;
+    std::atomic<std::pmr::memory_resource*> arena = nullptr;
+    std::atomic<std::thread::id> arenaThread;
+    mutable Mutex arenaMutex;
+    std::unordered_map<Id, EntityT*> arenaEntities;
+    std::array<Shard, shardsCount> shards;
+    mutable Mutex stagedMutex;
+    std::unordered_set<const EntityT*> staged;
+};
 }
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+
+#include "Synchronization.hpp"
+
+namespace FG::data
+{
+namespace internal
+{
+class EntityControlBlock;
+
+class EntityOwner
+{
+public:
+    virtual void release(const EntityControlBlock& entity) = 0;
+
+protected:
+    ~EntityOwner() = default;
+};
+
+//Embedded in every entity, so that EntityPtr handles only need to carry pointer to the entity itself.
+//Copies of an entity are separate objects, so they never inherit references count nor owner.
+//In thread safe build references count is atomic, so that handles may be copied and dropped on any thread.
+class EntityControlBlock
+{
+public:
+    EntityControlBlock() = default;
+
+    EntityControlBlock(const EntityControlBlock&) : EntityControlBlock()
+    {
+    }
+
+    EntityControlBlock& operator=(const EntityControlBlock&)
+    {
+        return *this;
+    }
+
+    void acquireReference() const
+    {
+        referencesCount.increment();
+    }
+
+    //Fails for entity whose last reference is already gone, as it's about to be released by its owner
+    bool tryAcquireReference() const
+    {
+        return referencesCount.incrementIfNotZero();
+    }
+
+    void releaseReference() const
+    {
+        if(referencesCount.decrement() && owner)
+            owner->release(*this);
+    }
+
+    //Fails if there are other references, also if they get acquired meanwhile on other threads
+    bool tryReleaseLastReference() const
+    {
+        if(!referencesCount.decrementIfOne())
+            return false;
+
+        if(owner)
+            owner->release(*this);
+        return true;
+    }
+
+    std::uint32_t getReferencesCount() const
+    {
+        return referencesCount.load();
+    }
+
+    void setOwner(EntityOwner* newOwner, std::pmr::memory_resource* newMemoryResource)
+    {
+        owner = newOwner;
+        memoryResource = newMemoryResource;
+    }
+
+    std::pmr::memory_resource* getMemoryResource() const
+    {
+        return memoryResource;
+    }
+
+private:
+    mutable ReferenceCounter referencesCount;
+    EntityOwner* owner = nullptr;
+    std::pmr::memory_resource* memoryResource = nullptr;
+};
+}
+}
\ No newline at end of file
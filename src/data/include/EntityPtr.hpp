@@ -1,52 +1,119 @@
 #pragma once
 
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
+#include <utility>
 
-#include "EntityCache.hpp"
+#include "EntityControlBlock.hpp"
 
 namespace FG::data
 {
-template<typename T>
-class EntityPtr : public std::shared_ptr<T>
+namespace internal
 {
-using Base = std::shared_ptr<T>;
+//Marks construction from a reference already acquired on handle's behalf
+struct AdoptReference
+{};
+}
 
+//Intrusive, one pointer wide handle to an entity owned by Database's entity cache.
+//Entity gets evicted from the cache when its last handle is gone.
+template<typename T>
+class EntityPtr
+{
 public:
-    EntityPtr() : Base(), cache(nullptr)
+    EntityPtr() = default;
+
+    EntityPtr(std::nullptr_t)
     {}
 
-    EntityPtr(const Base& ptr, internal::EntityCache<T>& c) : Base(ptr), cache(&c)
+    explicit EntityPtr(T* entity) : ptr(entity)
+    {
+        if(ptr)
+            ptr->acquireReference();
+    }
+
+    EntityPtr(T* entity, internal::AdoptReference) : ptr(entity)
     {}
 
-    EntityPtr(EntityPtr&&) = default;
-    EntityPtr(const EntityPtr&) = default;
+    EntityPtr(const EntityPtr& other) : EntityPtr(other.ptr)
+    {}
+
+    EntityPtr(EntityPtr&& other) noexcept : ptr(std::exchange(other.ptr, nullptr))
+    {}
 
     template<typename U>
     requires (std::same_as<std::remove_cv_t<T>, U> && !std::same_as<T, U>)
-    EntityPtr(const EntityPtr<U>& other)
-        : Base(other), cache(reinterpret_cast<const EntityPtr*>(&other)->cache)
+    EntityPtr(const EntityPtr<U>& other) : EntityPtr(other.get())
+    {}
+
+    template<typename U>
+    requires (std::same_as<std::remove_cv_t<T>, U> && !std::same_as<T, U>)
+    EntityPtr(EntityPtr<U>&& other) noexcept : ptr(std::exchange(other.ptr, nullptr))
+    {}
+
+    ~EntityPtr()
     {
+        reset();
     }
 
-    ~EntityPtr()
+    EntityPtr& operator=(EntityPtr other) noexcept
     {
-        //Usage count is decreased in shared_ptr's destructor,
-        //so value of 2 would now indicate that this and cache-hosted
-        //entity pointers are the last ones, and we can remove it from cache safely
-        if(Base::use_count() == 2)
-            cache->erase(*static_cast<Base*>(this));
+        std::swap(ptr, other.ptr);
+        return *this;
     }
 
-    EntityPtr& operator=(EntityPtr&&) = default;
-    EntityPtr& operator=(const EntityPtr&) = default;
+    void reset()
+    {
+        if(ptr)
+            std::exchange(ptr, nullptr)->releaseReference();
+    }
 
-    auto getCache() const
+    //Unlike checking use_count() first, it can't race with other threads acquiring the entity from its cache
+    bool resetIfLast()
     {
-        return cache;
+        if(!ptr || !ptr->tryReleaseLastReference())
+            return false;
+
+        ptr = nullptr;
+        return true;
+    }
+
+    T* get() const
+    {
+        return ptr;
+    }
+
+    T& operator*() const
+    {
+        return *ptr;
+    }
+
+    T* operator->() const
+    {
+        return ptr;
+    }
+
+    explicit operator bool() const
+    {
+        return ptr != nullptr;
+    }
+
+    std::uint32_t use_count() const
+    {
+        return ptr ? ptr->getReferencesCount() : 0;
+    }
+
+    friend bool operator==(const EntityPtr& lhs, const EntityPtr& rhs)
+    {
+        return lhs.ptr == rhs.ptr;
     }
 
 private:
-    internal::EntityCache<T>* cache;
+    template<typename U>
+    friend class EntityPtr;
+
+    T* ptr = nullptr;
 };
 }
\ No newline at end of file
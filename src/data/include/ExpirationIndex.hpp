@@ -0,0 +1,88 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "DatetimeUtils.hpp"
+#include "EntityUtils.hpp"
+
+namespace FG::data
+{
+struct ExpirationEntry
+{
+    Date expirationDate;
+    Id id;
+
+    auto operator<=>(const ExpirationEntry&) const = default;
+};
+
+namespace internal
+{
+//Ordered index of expiration dates of product instances, which are still to be consumed
+class ExpirationIndex
+{
+public:
+    void update(Id id, Date expirationDate, bool isConsumed)
+    {
+        if(isConsumed)
+        {
+            erase(id);
+            return;
+        }
+
+        auto [dateIt, inserted] = datesById.try_emplace(id, expirationDate);
+        if(!inserted)
+        {
+            if(dateIt->second == expirationDate)
+                return;
+            entries.erase({dateIt->second, id});
+            dateIt->second = expirationDate;
+        }
+        entries.insert({expirationDate, id});
+    }
+
+    void erase(Id id)
+    {
+        auto dateIt = datesById.find(id);
+        if(dateIt == datesById.end())
+            return;
+
+        entries.erase({dateIt->second, id});
+        datesById.erase(dateIt);
+    }
+
+    //Entries expiring within [from, to), ordered by expiration date
+    std::vector<ExpirationEntry> findBetween(Date from, Date to) const
+    {
+        std::vector<ExpirationEntry> found;
+        const auto endIt = entries.lower_bound({to, std::numeric_limits<Id>::min()});
+        for(auto entryIt = entries.lower_bound({from, std::numeric_limits<Id>::min()}); entryIt != endIt; ++entryIt)
+            found.push_back(*entryIt);
+        return found;
+    }
+
+    //At most count entries expiring soonest, but not earlier than given date
+    std::vector<ExpirationEntry> findSoonest(std::size_t count, Date from = Date(std::numeric_limits<Date::rep>::min())) const
+    {
+        std::vector<ExpirationEntry> found;
+        for(auto entryIt = entries.lower_bound({from, std::numeric_limits<Id>::min()});
+            entryIt != entries.end() && found.size() < count; ++entryIt)
+            found.push_back(*entryIt);
+        return found;
+    }
+
+    std::size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    std::set<ExpirationEntry> entries;
+    std::unordered_map<Id, Date> datesById;
+};
+}
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace FG::data
+{
+//Single-pass coroutine generator, yielded values are valid until generator is resumed again
+template<typename T>
+class Generator
+{
+public:
+    using value_type = std::remove_cvref_t<T>;
+
+    struct promise_type
+    {
+        Generator get_return_object()
+        {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(value_type& value) noexcept
+        {
+            current = std::addressof(value);
+            return {};
+        }
+
+        std::suspend_always yield_value(value_type&& value) noexcept
+        {
+            current = std::addressof(value);
+            return {};
+        }
+
+        void return_void()
+        {}
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+
+        void await_transform() = delete;
+
+        value_type* current = nullptr;
+        std::exception_ptr exception;
+    };
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Generator::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        explicit iterator(std::coroutine_handle<promise_type> h) : handle(h)
+        {}
+
+        value_type& operator*() const
+        {
+            return *handle.promise().current;
+        }
+
+        iterator& operator++()
+        {
+            resume(handle);
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t)
+        {
+            return !it.handle || it.handle.done();
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr))
+    {}
+
+    Generator& operator=(Generator other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+    ~Generator()
+    {
+        if(handle)
+            handle.destroy();
+    }
+
+    iterator begin()
+    {
+        resume(handle);
+        return iterator(handle);
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return {};
+    }
+
+private:
+    explicit Generator(std::coroutine_handle<promise_type> h) : handle(h)
+    {}
+
+    static void resume(std::coroutine_handle<promise_type> h)
+    {
+        h.resume();
+        if(h.promise().exception)
+            std::rethrow_exception(std::exchange(h.promise().exception, nullptr));
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include "DatetimeUtils.hpp"
+#include "EntityUtils.hpp"
+
+namespace FG::data
+{
+//Criteria which aggregated instances have to meet, unset ones match every instance.
+//Date ranges include their first day, but not the last one.
+struct InstanceFilter
+{
+    std::optional<bool> isConsumed;
+    std::optional<Date> expiringFrom;
+    std::optional<Date> expiringBefore;
+    std::optional<Date> purchasedFrom;
+    std::optional<Date> purchasedBefore;
+};
+
+struct InstanceAggregate
+{
+    std::size_t count = 0;
+    //Unset if no instance matched
+    std::optional<Date> earliestExpiration;
+    std::optional<Date> latestExpiration;
+
+    bool operator==(const InstanceAggregate&) const = default;
+};
+
+enum class InstanceGrouping
+{
+    Category,
+    Description
+};
+
+struct InstanceGroupAggregate
+{
+    Id groupId;
+    std::string groupName;
+    InstanceAggregate aggregate;
+
+    bool operator==(const InstanceGroupAggregate&) const = default;
+};
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "EntityPtr.hpp"
+#include "EntityUtils.hpp"
+
+namespace FG::data
+{
+namespace internal
+{
+template<typename EntityT>
+class EntityResolver
+{
+public:
+    using ResolveFunction = EntityPtr<EntityT> (*)(void* database, Id id);
+
+    EntityResolver(void* db, ResolveFunction function) : database(db), resolveFunction(function)
+    {}
+
+    EntityPtr<EntityT> resolve(Id id) const
+    {
+        return resolveFunction(database, id);
+    }
+
+private:
+    void* database;
+    ResolveFunction resolveFunction;
+};
+}
+
+//FK handle which keeps only ID of referenced entity until it is dereferenced for the first time.
+//Unresolved handles must not outlive Database they were retrieved from.
+//Resolved entity is published atomically, so that readers on many threads may dereference the same handle,
+//but the handle itself may be modified only when nothing else reads it.
+template<typename T>
+class LazyEntityPtr
+{
+public:
+    using EntityType = std::remove_const_t<T>;
+
+    LazyEntityPtr() = default;
+
+    LazyEntityPtr(std::nullptr_t)
+    {}
+
+    LazyEntityPtr(const EntityPtr<T>& resolvedEntity) : entity(acquire(resolvedEntity.get()))
+    {}
+
+    template<typename U>
+    requires (std::same_as<EntityType, U> && !std::same_as<T, U>)
+    LazyEntityPtr(const EntityPtr<U>& resolvedEntity) : entity(acquire(resolvedEntity.get()))
+    {}
+
+    LazyEntityPtr(Id entityId, const internal::EntityResolver<EntityType>& entityResolver)
+        : id(entityId), resolver(&entityResolver)
+    {}
+
+    LazyEntityPtr(const LazyEntityPtr& other)
+        : entity(acquire(other.entity.load(std::memory_order_acquire))), id(other.id), resolver(other.resolver)
+    {}
+
+    LazyEntityPtr(LazyEntityPtr&& other) noexcept
+        : entity(other.entity.exchange(nullptr, std::memory_order_acq_rel)), id(other.id), resolver(other.resolver)
+    {}
+
+    ~LazyEntityPtr()
+    {
+        release(entity.load(std::memory_order_acquire));
+    }
+
+    LazyEntityPtr& operator=(LazyEntityPtr other) noexcept
+    {
+        other.entity.store(entity.exchange(other.entity.load(std::memory_order_relaxed), std::memory_order_acq_rel),
+                           std::memory_order_relaxed);
+        std::swap(id, other.id);
+        std::swap(resolver, other.resolver);
+        return *this;
+    }
+
+    Id getId() const
+    {
+        const auto* resolvedEntity = entity.load(std::memory_order_acquire);
+        return resolvedEntity ? resolvedEntity->getId() : id;
+    }
+
+    bool isResolved() const
+    {
+        return entity.load(std::memory_order_acquire) || id == uninitializedId;
+    }
+
+    EntityPtr<T> resolve() const
+    {
+        return EntityPtr<T>(resolveEntity());
+    }
+
+    //Publishes entity retrieved elsewhere, unless another one got published first
+    void setResolved(const EntityPtr<EntityType>& resolvedEntity) const
+    {
+        publish(resolvedEntity.get());
+    }
+
+    void reset()
+    {
+        release(entity.exchange(nullptr, std::memory_order_acq_rel));
+        id = uninitializedId;
+        resolver = nullptr;
+    }
+
+    T* get() const
+    {
+        return resolveEntity();
+    }
+
+    T& operator*() const
+    {
+        return *get();
+    }
+
+    T* operator->() const
+    {
+        return get();
+    }
+
+    explicit operator bool() const
+    {
+        return entity.load(std::memory_order_acquire) || id != uninitializedId;
+    }
+
+private:
+    static T* acquire(T* entityToAcquire)
+    {
+        if(entityToAcquire)
+            entityToAcquire->acquireReference();
+        return entityToAcquire;
+    }
+
+    static void release(T* entityToRelease)
+    {
+        if(entityToRelease)
+            entityToRelease->releaseReference();
+    }
+
+    T* resolveEntity() const
+    {
+        if(auto* resolvedEntity = entity.load(std::memory_order_acquire); resolvedEntity || id == uninitializedId)
+            return resolvedEntity;
+
+        if(!resolver)
+            throw std::runtime_error("Lazy entity handle has no resolver");
+        return publish(resolver->resolve(id).get());
+    }
+
+    //Readers on other threads may resolve the same handle meanwhile, the first entity published is kept by all of them
+    T* publish(T* resolvedEntity) const
+    {
+        if(!resolvedEntity)
+            return nullptr;
+
+        T* publishedEntity = nullptr;
+        acquire(resolvedEntity);
+        if(entity.compare_exchange_strong(publishedEntity, resolvedEntity, std::memory_order_acq_rel, std::memory_order_acquire))
+            return resolvedEntity;
+
+        release(resolvedEntity);
+        return publishedEntity;
+    }
+
+    mutable std::atomic<T*> entity = nullptr;
+    Id id = uninitializedId;
+    const internal::EntityResolver<EntityType>* resolver = nullptr;
+};
+
+template<class T>
+concept WithLazyFkEntity = WithFkEntity<T>
+    && requires(T entity, LazyEntityPtr<const typename T::FkEntity> fkEntity) { entity.setFkEntity(fkEntity); };
+}
\ No newline at end of file
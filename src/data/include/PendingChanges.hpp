@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include "EntityPtr.hpp"
+#include "EntityUtils.hpp"
+
+namespace FG::data
+{
+namespace internal
+{
+template<typename EntityT>
+struct EntityComparator
+{
+    using is_transparent = std::true_type;
+
+    bool operator()(const Id& lhs, const EntityPtr<EntityT>& rhs) const
+    {
+        return lhs < rhs->getId();
+    }
+
+    bool operator()(const EntityPtr<EntityT>& lhs, const Id& rhs) const
+    {
+        return lhs->getId() < rhs;
+    }
+
+    bool operator()(const EntityPtr<EntityT>& lhs, const EntityPtr<EntityT>& rhs) const
+    {
+        return lhs->getId() < rhs->getId();
+    }
+};
+
+template<typename EntityT>
+struct PendingChanges
+{
+    using EntitiesSet = std::set<EntityPtr<EntityT>, EntityComparator<EntityT>>;
+
+    bool isCreated(const EntityPtr<EntityT>& entity) const
+    {
+        return entity->getId() == uninitializedId
+            && std::find(created.begin(), created.end(), entity) != created.end();
+    }
+
+    bool isUpdated(Id id) const
+    {
+        return updated.find(id) != updated.end();
+    }
+
+    void addCreated(const EntityPtr<EntityT>& entity)
+    {
+        created.push_back(entity);
+    }
+
+    void addUpdated(const EntityPtr<EntityT>& entity)
+    {
+        //Entities which are still to be created will have their current state inserted anyway
+        if(!isCreated(entity))
+            updated.insert(entity);
+    }
+
+    void addRemoved(EntityPtr<EntityT>&& entity)
+    {
+        if(isCreated(entity))
+        {
+            std::erase(created, entity);
+            entity->invalidate();
+            return;
+        }
+
+        updated.erase(entity);
+        removed.insert(std::move(entity));
+    }
+
+    bool empty() const
+    {
+        return created.empty() && updated.empty() && removed.empty();
+    }
+
+    std::vector<EntityPtr<EntityT>> created;
+    EntitiesSet updated;
+    EntitiesSet removed;
+};
+}
+}
\ No newline at end of file
@@ -1,6 +1,67 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include "Database.hpp"
+#include "BarcodeIndex.hpp"
+#include "ConnectionPool.hpp"
+#include "DatabaseOptions.hpp"
+#include "ExpirationIndex.hpp"
+#include "InstanceAggregates.hpp"
+#include "Synchronization.hpp"
+
+namespace sqlite_orm
+{
+//Dates are kept as plain integer number of days since Unix epoch
+template<>
+struct type_printer<FG::data::Date> : public integer_printer
+{};
+
+template<>
+struct statement_binder<FG::data::Date>
+{
+    int bind(sqlite3_stmt* stmt, int index, const FG::data::Date& value) const
+    {
+        return sqlite3_bind_int(stmt, index, value.getDaysSinceEpoch());
+    }
+};
+
+template<>
+struct field_printer<FG::data::Date>
+{
+    std::string operator()(const FG::data::Date& value) const
+    {
+        return std::to_string(value.getDaysSinceEpoch());
+    }
+};
+
+template<>
+struct row_extractor<FG::data::Date>
+{
+    FG::data::Date extract(sqlite3_stmt* stmt, int columnIndex) const
+    {
+        return FG::data::Date(sqlite3_column_int(stmt, columnIndex));
+    }
+
+    FG::data::Date extract(sqlite3_value* value) const
+    {
+        return FG::data::Date(sqlite3_value_int(value));
+    }
+};
+}
 
 namespace FG::data
 {
@@ -11,6 +72,15 @@ inline auto makeStorage(const std::string& dbFilePath = "")
     using namespace sqlite_orm;
     return make_storage(
         dbFilePath,
+        make_index<ProductDescription>("idx_descriptions_categoryId", &ProductDescription::getFkId),
+        //Most descriptions are expected to have no barcode, so they are left out of the index
+        make_index<ProductDescription>("idx_descriptions_barcode", &ProductDescription::barcode,
+            where(is_not_null(&ProductDescription::barcode))),
+        make_index<ProductInstance>("idx_instances_descriptionId", &ProductInstance::getFkId),
+        make_index<ProductInstance>("idx_instances_expirationDate", &ProductInstance::expirationDate),
+        //Not a partial index on isConsumed, as SQLite can't match it with conditions bound as parameters
+        make_index<ProductInstance>("idx_instances_isConsumed_expirationDate",
+            &ProductInstance::isConsumed, &ProductInstance::expirationDate),
         make_table<ProductCategory>("categories",
             make_column("id", &ProductCategory::getId, &ProductCategory::setId, primary_key().autoincrement()),
             make_column("name", &ProductCategory::name),
@@ -30,8 +100,8 @@ inline auto makeStorage(const std::string& dbFilePath = "")
         make_table<ProductInstance>("instances",
             make_column("id", &ProductInstance::getId, &ProductInstance::setId, primary_key().autoincrement()),
             make_column("descriptionId", &ProductInstance::getFkId, &ProductInstance::setFkId),
-            make_column("purchaseDate", &ProductInstance::getPurchaseDateTimestamp, &ProductInstance::setPurchaseDateTimestamp),
-            make_column("expirationDate", &ProductInstance::getExpirationDateTimestamp, &ProductInstance::setExpirationDateTimestamp),
+            make_column("purchaseDate", &ProductInstance::purchaseDate),
+            make_column("expirationDate", &ProductInstance::expirationDate),
             make_column("daysToExpireWhenOpened", &ProductInstance::daysToExpireWhenOpened),
             make_column("isOpen", &ProductInstance::isOpen),
             make_column("isConsumed", &ProductInstance::isConsumed),
@@ -39,6 +109,48 @@ inline auto makeStorage(const std::string& dbFilePath = "")
         )
     );
 }
+
+template<typename StorageT, typename EntityT>
+struct PreparedStatements
+{
+    using GetStatement = decltype(std::declval<StorageT&>().prepare(sqlite_orm::get<EntityT>(Id{})));
+    using InsertStatement = decltype(std::declval<StorageT&>().prepare(sqlite_orm::insert(std::ref(std::declval<EntityT&>()))));
+    using UpdateStatement = decltype(std::declval<StorageT&>().prepare(sqlite_orm::update(std::cref(std::declval<const EntityT&>()))));
+    using RemoveStatement = decltype(std::declval<StorageT&>().prepare(sqlite_orm::remove<EntityT>(Id{})));
+
+    std::optional<GetStatement> getStatement;
+    std::optional<InsertStatement> insertStatement;
+    std::optional<UpdateStatement> updateStatement;
+    std::optional<RemoveStatement> removeStatement;
+};
+
+using ProductStorage = decltype(makeStorage());
+
+using ProductStatements = std::tuple<
+    PreparedStatements<ProductStorage, ProductCategory>,
+    PreparedStatements<ProductStorage, ProductDescription>,
+    PreparedStatements<ProductStorage, ProductInstance>>;
+
+//Connection which only reads, along with statements prepared for it
+struct ReadConnection
+{
+    ReadConnection(const std::string& dbFilePath, const DatabaseOptions& options);
+
+    ProductStorage storage;
+    //Declared after the storage, so that statements are finalized before the connection gets closed
+    ProductStatements preparedStatements;
+};
+
+//Statements which were stepped only until the first row would otherwise keep read transaction open
+struct StatementResetter
+{
+    ~StatementResetter()
+    {
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_stmt* stmt;
+};
 }
 
 class ProductDatabase : public Database<ProductDatabase, ProductCategory, ProductDescription, ProductInstance>
@@ -46,57 +158,362 @@ class ProductDatabase : public Database<ProductDatabase, ProductCategory, Produc
 friend class Database<ProductDatabase, ProductCategory, ProductDescription, ProductInstance>;
 
 public:
-    ProductDatabase(const std::string& dbFilePath = "");
+    //Version 1 stores instance dates as days since epoch instead of seconds
+    static constexpr int schemaVersion = 1;
+
+    ProductDatabase(const std::string& dbFilePath = "", const DatabaseOptions& options = {});
+
+    //Expiration queries are answered from in-memory index of instances which are not consumed yet
+    std::vector<ExpirationEntry> findExpiring(Date from, Date to);
+
+    std::vector<ExpirationEntry> findSoonestExpiring(std::size_t count, Date from);
+
+    std::vector<EntityPtr<ProductInstance>> retrieveExpiring(Date from, Date to);
+
+    //Empty EntityPtr is returned for unknown barcodes, the earliest created description is returned for shared ones
+    EntityPtr<ProductDescription> findByBarcode(std::string_view barcode);
+
+    std::vector<EntityPtr<ProductDescription>> findByBarcodes(const std::vector<std::string_view>& barcodes);
+
+    //Aggregates are computed by SQLite, no entities get loaded to caches.
+    //Changes pending in unfinished session are not taken into account.
+    InstanceAggregate aggregateInstances(const InstanceFilter& filter = {});
+
+    //Groups are ordered by their IDs, the ones without any matching instance are omitted
+    std::vector<InstanceGroupAggregate> aggregateInstancesBy(InstanceGrouping grouping, const InstanceFilter& filter = {});
 
 private:
     using Base = Database<ProductDatabase, ProductCategory, ProductDescription, ProductInstance>;
-    using StorageT = decltype(internal::makeStorage());
+    using StorageT = internal::ProductStorage;
+
+    //Default SQLITE_MAX_VARIABLE_NUMBER of SQLite versions older than 3.32.0
+    static constexpr std::size_t maxIdsPerQuery = 999;
     
     template<typename EntityT>
     void insertImpl(EntityT& entity)
     {
-        auto id = storage.insert(entity);
+        std::lock_guard lock(storageMutex);
+        auto& statements = getPreparedStatements<EntityT>();
+        if(!statements.insertStatement)
+            statements.insertStatement.emplace(storage.prepare(sqlite_orm::insert(std::ref(entity))));
+        else
+            statements.insertStatement->expression.obj = std::ref(entity);
+
+        auto id = storage.execute(*statements.insertStatement);
         entity.setId(id);
+        updateIndexes(entity);
     }
 
     template<typename EntityT>
     EntityT retrieveImpl(Id id)
     {
-        return storage.get<EntityT>(id);
+        return read([id](StorageT& readStorage, internal::ProductStatements& readStatements) {
+            auto& statements = std::get<internal::PreparedStatements<StorageT, EntityT>>(readStatements);
+            if(!statements.getStatement)
+                statements.getStatement.emplace(readStorage.prepare(sqlite_orm::get<EntityT>(id)));
+            else
+                sqlite_orm::get<0>(*statements.getStatement) = id;
+
+            internal::StatementResetter resetter{statements.getStatement->stmt};
+            return readStorage.execute(*statements.getStatement);
+        });
     }
 
     template<typename EntityT>
-    auto retrieveImpl(const std::set<Id>& idsSet)
+    std::vector<EntityT> retrieveImpl(const std::set<Id>& idsSet)
     {
-        std::vector ids(idsSet.begin(), idsSet.end());
-        return storage.get_all<EntityT>(sqlite_orm::where(sqlite_orm::in(sqlite_orm::column<EntityT>(&EntityT::getId), ids)));
+        std::vector<EntityT> entities;
+        std::vector<Id> ids;
+        ids.reserve(std::min(idsSet.size(), maxIdsPerQuery));
+        for(auto idIt = idsSet.begin(); idIt != idsSet.end();)
+        {
+            ids.clear();
+            for(; idIt != idsSet.end() && ids.size() < maxIdsPerQuery; ++idIt)
+                ids.push_back(*idIt);
+
+            auto chunk = read([&ids](StorageT& readStorage, internal::ProductStatements&) {
+                const auto idColumn = sqlite_orm::column<EntityT>(&EntityT::getId);
+                return readStorage.get_all<EntityT>(sqlite_orm::where(sqlite_orm::in(idColumn, ids)), sqlite_orm::order_by(idColumn));
+            });
+            if(entities.empty())
+                entities = std::move(chunk);
+            else
+                entities.insert(entities.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
+        }
+        return entities;
     }
 
     template<typename EntityT, typename ConditionT>
     requires(!std::is_const_v<ConditionT>)
     auto retrieveImpl(ConditionT&& cond)
     {
-        return storage.get_all<EntityT>(std::move(cond));
+        return read([&cond](StorageT& readStorage, internal::ProductStatements&) {
+            return readStorage.get_all<EntityT>(std::move(cond));
+        });
     }
 
     template<typename EntityT>
     auto retrieveImpl()
     {
-        return storage.get_all<EntityT>();
+        return read([](StorageT& readStorage, internal::ProductStatements&) {
+            return readStorage.get_all<EntityT>();
+        });
+    }
+
+    template<WithFkEntity EntityT>
+    auto retrieveJoinedImpl(const std::set<Id>& idsSet)
+    {
+        decltype(selectJoined<EntityT>()) rows;
+        std::vector<Id> ids;
+        ids.reserve(std::min(idsSet.size(), maxIdsPerQuery));
+        for(auto idIt = idsSet.begin(); idIt != idsSet.end();)
+        {
+            ids.clear();
+            for(; idIt != idsSet.end() && ids.size() < maxIdsPerQuery; ++idIt)
+                ids.push_back(*idIt);
+
+            //Join may be planned starting from FK tables, so order of IDs has to be requested explicitly
+            auto idColumn = sqlite_orm::column<EntityT>(&EntityT::getId);
+            auto chunk = selectJoined<EntityT>(sqlite_orm::where(sqlite_orm::in(idColumn, ids)), sqlite_orm::order_by(idColumn));
+            rows.insert(rows.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
+        }
+        return rows;
+    }
+
+    template<WithFkEntity EntityT, typename ConditionT>
+    requires(!std::is_const_v<ConditionT>)
+    auto retrieveJoinedImpl(ConditionT&& cond)
+    {
+        return selectJoined<EntityT>(std::forward<ConditionT>(cond));
+    }
+
+    template<WithFkEntity EntityT>
+    auto retrieveJoinedImpl()
+    {
+        return selectJoined<EntityT>(sqlite_orm::order_by(sqlite_orm::column<EntityT>(&EntityT::getId)));
+    }
+
+    //Every row holds entity followed by its whole chain of FK entities, all decoded from a single SELECT
+    template<WithFkEntity EntityT, typename... Conditions>
+    auto selectJoined(Conditions&&... conds)
+    {
+        return read([&conds...](StorageT& readStorage, internal::ProductStatements&) {
+            using namespace sqlite_orm;
+            auto joinCategories = inner_join<ProductCategory>(
+                on(c(column<ProductDescription>(&ProductDescription::getFkId)) == column<ProductCategory>(&ProductCategory::getId)));
+            if constexpr(std::same_as<EntityT, ProductInstance>)
+            {
+                auto joinDescriptions = inner_join<ProductDescription>(
+                    on(c(column<ProductInstance>(&ProductInstance::getFkId)) == column<ProductDescription>(&ProductDescription::getId)));
+                return readStorage.select(columns(object<ProductInstance>(), object<ProductDescription>(), object<ProductCategory>()),
+                                          joinDescriptions, joinCategories, std::forward<Conditions>(conds)...);
+            }
+            else
+            {
+                return readStorage.select(columns(object<ProductDescription>(), object<ProductCategory>()),
+                                          joinCategories, std::forward<Conditions>(conds)...);
+            }
+        });
+    }
+
+    template<typename EntityT, typename SortT, typename OrderBy>
+    std::vector<EntityT> retrievePageImpl(const std::optional<PageKey<SortT>>& afterKey, std::size_t limit,
+                                          OrderBy orderBy, SortOrder order)
+    {
+        return read([&](StorageT& readStorage, internal::ProductStatements&) {
+            using namespace sqlite_orm;
+            auto sortColumn = column<EntityT>(orderBy);
+            auto idColumn = column<EntityT>(&EntityT::getId);
+            auto pageLimit = sqlite_orm::limit(static_cast<int>(limit));
+            if(order == SortOrder::Ascending)
+            {
+                auto ordering = multi_order_by(order_by(sortColumn).asc(), order_by(idColumn).asc());
+                if(!afterKey)
+                    return readStorage.get_all<EntityT>(ordering, pageLimit);
+
+                //Leading range condition lets SQLite seek the sort column index instead of scanning it
+                return readStorage.get_all<EntityT>(
+                    where(c(sortColumn) >= afterKey->sortValue
+                          and (c(sortColumn) > afterKey->sortValue or c(idColumn) > afterKey->id)),
+                    ordering, pageLimit);
+            }
+
+            auto ordering = multi_order_by(order_by(sortColumn).desc(), order_by(idColumn).desc());
+            if(!afterKey)
+                return readStorage.get_all<EntityT>(ordering, pageLimit);
+
+            return readStorage.get_all<EntityT>(
+                where(c(sortColumn) <= afterKey->sortValue
+                      and (c(sortColumn) < afterKey->sortValue or c(idColumn) < afterKey->id)),
+                ordering, pageLimit);
+        });
+    }
+
+    template<typename EntityT, auto... Columns, typename... Conditions>
+    auto selectImpl(Conditions&&... conds)
+    {
+        return read([&conds...](StorageT& readStorage, internal::ProductStatements&) {
+            return readStorage.select(sqlite_orm::columns(sqlite_orm::column<EntityT>(Columns)...), std::forward<Conditions>(conds)...);
+        });
+    }
+
+    //Statement stays live between batches, so connection is held, like in read(), until stream is destroyed
+    template<typename EntityT, typename... Conditions>
+    Generator<EntityT> streamImpl(Conditions... conds)
+    {
+        if constexpr(internal::threadSafe)
+        {
+            if(readConnections && transactionThread.load(std::memory_order_relaxed) != std::this_thread::get_id())
+            {
+                auto connection = readConnections->acquire();
+                for(auto& entity : connection->storage.iterate<EntityT>(conds...))
+                    co_yield entity;
+                co_return;
+            }
+        }
+
+        std::unique_lock lock(storageMutex);
+        for(auto& entity : storage.iterate<EntityT>(conds...))
+            co_yield entity;
     }
 
     template<typename EntityT>
     void updateImpl(const EntityT& entity)
     {
-        storage.update(entity);
+        std::lock_guard lock(storageMutex);
+        auto& statements = getPreparedStatements<EntityT>();
+        if(!statements.updateStatement)
+            statements.updateStatement.emplace(storage.prepare(sqlite_orm::update(std::cref(entity))));
+        else
+            statements.updateStatement->expression.obj = std::cref(entity);
+
+        storage.execute(*statements.updateStatement);
+        updateIndexes(entity);
     }
 
     template<typename EntityT>
     void removeImpl(const EntityT& entity)
     {
-        storage.remove<EntityT>(entity.getId());
+        std::lock_guard lock(storageMutex);
+        auto& statements = getPreparedStatements<EntityT>();
+        if(!statements.removeStatement)
+            statements.removeStatement.emplace(storage.prepare(sqlite_orm::remove<EntityT>(entity.getId())));
+        else
+            sqlite_orm::get<0>(*statements.removeStatement) = entity.getId();
+
+        storage.execute(*statements.removeStatement);
+        removeFromIndexes(entity);
+    }
+
+    //Writer's connection is held for the whole transaction, reads of its thread go there to see uncommitted changes
+    template<typename Func>
+    void transactionImpl(Func&& func)
+    {
+        std::lock_guard lock(storageMutex);
+        transactionThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        try
+        {
+            auto guard = storage.transaction_guard();
+            func();
+            guard.commit();
+        }
+        catch(...)
+        {
+            transactionThread.store({}, std::memory_order_relaxed);
+            //Indexes could have been updated with changes that got rolled back, they will be rebuilt when needed
+            std::lock_guard indexesLock(indexesMutex);
+            expirationIndex.reset();
+            barcodeIndex.reset();
+            throw;
+        }
+        transactionThread.store({}, std::memory_order_relaxed);
+    }
+
+    //Other threads read through pooled connections, so they neither wait for nor see writer's transaction
+    template<typename Func>
+    auto read(Func&& func)
+    {
+        if constexpr(internal::threadSafe)
+        {
+            if(readConnections && transactionThread.load(std::memory_order_relaxed) != std::this_thread::get_id())
+            {
+                auto connection = readConnections->acquire();
+                return func(connection->storage, connection->preparedStatements);
+            }
+        }
+
+        std::lock_guard lock(storageMutex);
+        return func(storage, preparedStatements);
+    }
+
+    //Index is built with storage locked, so that no write slips in between reading its rows and publishing it
+    template<typename IndexT, typename BuildFunc, typename QueryFunc>
+    auto queryIndex(std::optional<IndexT>& index, BuildFunc&& build, QueryFunc&& query)
+    {
+        {
+            std::lock_guard lock(indexesMutex);
+            if(index)
+                return query(std::as_const(*index));
+        }
+
+        std::lock_guard storageLock(storageMutex);
+        std::lock_guard lock(indexesMutex);
+        if(!index)
+            build(index.emplace());
+        return query(std::as_const(*index));
+    }
+
+    template<typename EntityT>
+    void updateIndexes(const EntityT&)
+    {}
+
+    void updateIndexes(const ProductDescription& description);
+
+    void updateIndexes(const ProductInstance& instance);
+
+    template<typename EntityT>
+    void removeFromIndexes(const EntityT&)
+    {}
+
+    void removeFromIndexes(const ProductDescription& description);
+
+    void removeFromIndexes(const ProductInstance& instance);
+
+    template<typename QueryFunc>
+    auto queryExpirationIndex(QueryFunc&& query)
+    {
+        return queryIndex(expirationIndex, [this](auto& index) { buildExpirationIndex(index); }, std::forward<QueryFunc>(query));
+    }
+
+    template<typename QueryFunc>
+    auto queryBarcodeIndex(QueryFunc&& query)
+    {
+        return queryIndex(barcodeIndex, [this](auto& index) { buildBarcodeIndex(index); }, std::forward<QueryFunc>(query));
+    }
+
+    void buildExpirationIndex(internal::ExpirationIndex& index);
+
+    void buildBarcodeIndex(internal::BarcodeIndex& index);
+
+    template<typename EntityT>
+    internal::PreparedStatements<StorageT, EntityT>& getPreparedStatements()
+    {
+        return std::get<internal::PreparedStatements<StorageT, EntityT>>(preparedStatements);
     }
 
     StorageT storage;
+    //Declared after the storage, so that statements are finalized before the connection gets closed
+    internal::ProductStatements preparedStatements;
+    //Guards writer's connection, locked for the whole transaction
+    internal::RecursiveMutex storageMutex;
+    std::atomic<std::thread::id> transactionThread;
+    //Opened only for file databases in thread safe build
+    std::optional<internal::ConnectionPool<internal::ReadConnection>> readConnections;
+    //Indexes are built on first query using them
+    internal::Mutex indexesMutex;
+    std::optional<internal::ExpirationIndex> expirationIndex;
+    std::optional<internal::BarcodeIndex> barcodeIndex;
 };
+
+using ProductChanges = ProductDatabase::Changes;
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+namespace FG::data::internal
+{
+#ifdef FG_DATA_THREAD_SAFE
+constexpr bool threadSafe = true;
+
+using Mutex = std::mutex;
+using RecursiveMutex = std::recursive_mutex;
+using SharedMutex = std::shared_mutex;
+
+//References count of entities, whose handles may be copied and dropped on any thread
+class ReferenceCounter
+{
+public:
+    void increment()
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //Fails once count dropped to zero, as nothing may revive the entity then
+    bool incrementIfNotZero()
+    {
+        auto current = count.load(std::memory_order_relaxed);
+        while(current > 0)
+        {
+            if(count.compare_exchange_weak(current, current + 1, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    //Returns true for the last reference
+    bool decrement()
+    {
+        return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    //Drops only the last reference, so no other thread can acquire it between the check and the drop
+    bool decrementIfOne()
+    {
+        std::uint32_t expected = 1;
+        return count.compare_exchange_strong(expected, 0, std::memory_order_acq_rel, std::memory_order_relaxed);
+    }
+
+    std::uint32_t load() const
+    {
+        return count.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<std::uint32_t> count = 0;
+};
+#else
+constexpr bool threadSafe = false;
+
+//Stands in for mutexes when the data layer is built for single thread only, so that locking costs nothing
+struct NullMutex
+{
+    void lock()
+    {}
+
+    bool try_lock()
+    {
+        return true;
+    }
+
+    void unlock()
+    {}
+
+    void lock_shared()
+    {}
+
+    bool try_lock_shared()
+    {
+        return true;
+    }
+
+    void unlock_shared()
+    {}
+};
+
+using Mutex = NullMutex;
+using RecursiveMutex = NullMutex;
+using SharedMutex = NullMutex;
+
+//Plain integer counterpart of the atomic references count
+class ReferenceCounter
+{
+public:
+    void increment()
+    {
+        ++count;
+    }
+
+    bool incrementIfNotZero()
+    {
+        if(count == 0)
+            return false;
+        ++count;
+        return true;
+    }
+
+    bool decrement()
+    {
+        return --count == 0;
+    }
+
+    bool decrementIfOne()
+    {
+        if(count != 1)
+            return false;
+        count = 0;
+        return true;
+    }
+
+    std::uint32_t load() const
+    {
+        return count;
+    }
+
+private:
+    std::uint32_t count = 0;
+};
+#endif
+}
\ No newline at end of file
@@ -1,9 +1,17 @@
+#include <QDir>
+#include <QStandardPaths>
 #include "MainWindow.hpp"
+#include "ProductDatabase.hpp"
 
 int main(int argc, char** argv)
 {
     QApplication app(argc, argv);
-    FG::Ui::MainWindow window;
+    const QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    dataDir.mkpath(".");
+    FG::data::ProductDatabase db(dataDir.filePath("FridgeGuard.db").toStdString(), FG::data::DatabaseOptions::durable());
+    //Views resolve descriptions of the rows they show in batches, instead of loading them with every instance
+    db.setFkLoadingPolicy(FG::data::FkLoadingPolicy::Lazy);
+    FG::Ui::MainWindow window(db);
     window.show();
 
     return app.exec();
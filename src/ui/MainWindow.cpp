@@ -2,12 +2,23 @@
 
 namespace FG::Ui
 {
-MainWindow::MainWindow() : QMainWindow(), mainWindow(std::make_unique<::Ui::MainWindow>())
+MainWindow::MainWindow(data::ProductDatabase& database)
+    : QMainWindow(), mainWindow(std::make_unique<::Ui::MainWindow>()), changesNotifier(database),
+      instanceModel(database, changesNotifier)
 {
     mainWindow->setupUi(this);
+    mainWindow->inventoryView->setModel(&instanceModel);
+    connect(&changesNotifier, &ProductChangesNotifier::productsChanged, this, &MainWindow::onProductsChanged);
 }
 
 void MainWindow::on_someTestButton_clicked()
 {
 }
+
+void MainWindow::onProductsChanged(const FG::data::ProductChanges& changes)
+{
+    const auto& instanceChanges = changes.get<data::ProductInstance>().getAll();
+    if(!instanceChanges.empty())
+        statusBar()->showMessage(tr("%n product(s) changed", nullptr, static_cast<int>(instanceChanges.size())), 3000);
 }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include <utility>
+#include "ProductChangesNotifier.hpp"
+
+namespace FG::Ui
+{
+ProductChangesNotifier::ProductChangesNotifier(data::ProductDatabase& database, QObject* parent)
+    : QObject(parent), db(database),
+      listenerId(db.addChangeListener([this](const data::ProductChanges& changes) { collect(changes); }))
+{
+}
+
+ProductChangesNotifier::~ProductChangesNotifier()
+{
+    //Waits for changes being collected on the writer thread, so none get collected after this
+    db.removeChangeListener(listenerId);
+}
+
+void ProductChangesNotifier::collect(const data::ProductChanges& changes)
+{
+    std::lock_guard lock(collectedMutex);
+    collected.merge(changes);
+    if(emissionScheduled)
+        return;
+
+    //Queued call runs once control is back in the event loop, after all changes made meanwhile
+    emissionScheduled = true;
+    QMetaObject::invokeMethod(this, [this] { emitCollected(); }, Qt::QueuedConnection);
+}
+
+void ProductChangesNotifier::emitCollected()
+{
+    data::ProductChanges changes;
+    {
+        std::lock_guard lock(collectedMutex);
+        changes = std::exchange(collected, {});
+        emissionScheduled = false;
+    }
+
+    if(!changes.empty())
+        emit productsChanged(changes);
+}
+}
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <ranges>
+#include <set>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <QDate>
+#include "ProductInstanceModel.hpp"
+
+namespace FG::Ui
+{
+namespace
+{
+QDate toQDate(data::Date date)
+{
+    return QDate(1970, 1, 1).addDays(date.getDaysSinceEpoch());
+}
+
+data::PageKey<data::Date> keyOf(const data::ProductInstance& instance)
+{
+    return {instance.expirationDate, instance.getId()};
+}
+
+bool isKeyBefore(const data::PageKey<data::Date>& lhs, const data::PageKey<data::Date>& rhs)
+{
+    return std::tie(lhs.sortValue, lhs.id) < std::tie(rhs.sortValue, rhs.id);
+}
+}
+
+ProductInstanceModel::ProductInstanceModel(data::ProductDatabase& database, ProductChangesNotifier& changesNotifier, QObject* parent)
+    : QAbstractTableModel(parent), db(database)
+{
+    connect(&changesNotifier, &ProductChangesNotifier::productsChanged, this, &ProductInstanceModel::onProductsChanged);
+}
+
+int ProductInstanceModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(rowKeys.size());
+}
+
+int ProductInstanceModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnsCount;
+}
+
+QVariant ProductInstanceModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || (role != Qt::DisplayRole && role != Qt::CheckStateRole))
+        return {};
+
+    const auto* instance = instanceAt(index.row());
+    if(!instance)
+        return {};
+
+    if(role == Qt::CheckStateRole)
+    {
+        if(index.column() == OpenColumn)
+            return instance->isOpen ? Qt::Checked : Qt::Unchecked;
+        if(index.column() == ConsumedColumn)
+            return instance->isConsumed ? Qt::Checked : Qt::Unchecked;
+        return {};
+    }
+
+    switch(index.column())
+    {
+    case NameColumn:
+        return QString::fromStdString(instance->description->name);
+    case PurchaseDateColumn:
+        return toQDate(instance->purchaseDate);
+    case ExpirationDateColumn:
+        return toQDate(instance->expirationDate);
+    default:
+        return {};
+    }
+}
+
+QVariant ProductInstanceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch(section)
+    {
+    case NameColumn:
+        return tr("Product");
+    case PurchaseDateColumn:
+        return tr("Purchased");
+    case ExpirationDateColumn:
+        return tr("Expires");
+    case OpenColumn:
+        return tr("Open");
+    case ConsumedColumn:
+        return tr("Consumed");
+    default:
+        return {};
+    }
+}
+
+bool ProductInstanceModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && !fetchedAll;
+}
+
+void ProductInstanceModel::fetchMore(const QModelIndex& parent)
+{
+    if(parent.isValid() || fetchedAll)
+        return;
+
+    auto page = db.retrievePage<data::ProductInstance>(nextPageKey, pageSize, &data::ProductInstance::expirationDate);
+    nextPageKey = page.nextKey;
+    fetchedAll = !page.nextKey;
+    if(page.entities.empty())
+        return;
+
+    const auto firstRow = rowKeys.size();
+    beginInsertRows({}, static_cast<int>(firstRow), static_cast<int>(firstRow + page.entities.size() - 1));
+    for(const auto& instance : page.entities)
+    {
+        rowKeys.push_back(keyOf(*instance));
+        rowExpirationDates.emplace(instance->getId(), instance->expirationDate);
+    }
+    endInsertRows();
+
+    //Rows which were just fetched are the ones about to be shown
+    setWindow(firstRow, std::move(page.entities));
+}
+
+const data::ProductInstance* ProductInstanceModel::instanceAt(std::size_t row) const
+{
+    if(row < windowFirstRow || row >= windowFirstRow + window.size())
+        moveWindow(row);
+    return window[row - windowFirstRow].get();
+}
+
+void ProductInstanceModel::moveWindow(std::size_t row) const
+{
+    const auto firstRow = row - std::min(row, windowSize / 2);
+    const auto lastRow = std::min(firstRow + windowSize, rowKeys.size());
+    std::set<data::Id> ids;
+    for(auto i = firstRow; i < lastRow; ++i)
+        ids.insert(rowKeys[i].id);
+
+    //Rows still in the old window are found in cache, as it's released only after the new one is retrieved
+    const auto retrieved = db.retrieve<data::ProductInstance>(ids);
+    std::vector<data::EntityPtr<data::ProductInstance>> instances;
+    instances.reserve(lastRow - firstRow);
+    for(auto i = firstRow; i < lastRow; ++i)
+    {
+        //Instance removed in the meantime leaves an empty row, until notification about its removal comes
+        auto instanceIt = std::ranges::lower_bound(retrieved, rowKeys[i].id, {}, [](const auto& instance) { return instance->getId(); });
+        if(instanceIt != retrieved.end() && (*instanceIt)->getId() == rowKeys[i].id)
+            instances.push_back(*instanceIt);
+        else
+            instances.emplace_back(nullptr);
+    }
+    setWindow(firstRow, std::move(instances));
+}
+
+void ProductInstanceModel::setWindow(std::size_t firstRow, std::vector<data::EntityPtr<data::ProductInstance>>&& instances) const
+{
+    window = std::move(instances);
+    windowFirstRow = firstRow;
+
+    //Descriptions of the whole window are resolved with a single query, unless they're already loaded
+    db.resolveLazy(window
+        | std::views::filter([](const auto& instance) { return static_cast<bool>(instance); })
+        | std::views::transform([](auto& instance) -> auto& { return instance->description; }));
+}
+
+std::optional<std::size_t> ProductInstanceModel::findRow(data::Id id) const
+{
+    const auto dateIt = rowExpirationDates.find(id);
+    if(dateIt == rowExpirationDates.end())
+        return std::nullopt;
+    return static_cast<std::size_t>(std::ranges::lower_bound(rowKeys, RowKey{dateIt->second, id}, isKeyBefore) - rowKeys.begin());
+}
+
+void ProductInstanceModel::placeRow(data::EntityPtr<data::ProductInstance>&& instance)
+{
+    const auto key = keyOf(*instance);
+    if(!fetchedAll && !(nextPageKey && isKeyBefore(key, *nextPageKey)))
+        return;
+
+    const auto row = static_cast<std::size_t>(std::ranges::lower_bound(rowKeys, key, isKeyBefore) - rowKeys.begin());
+    beginInsertRows({}, static_cast<int>(row), static_cast<int>(row));
+    rowKeys.insert(rowKeys.begin() + row, key);
+    rowExpirationDates.emplace(key.id, key.sortValue);
+    if(row < windowFirstRow)
+        ++windowFirstRow;
+    else if(row <= windowFirstRow + window.size() && !window.empty())
+        window.insert(window.begin() + (row - windowFirstRow), std::move(instance));
+    endInsertRows();
+}
+
+void ProductInstanceModel::eraseRow(std::size_t row)
+{
+    beginRemoveRows({}, static_cast<int>(row), static_cast<int>(row));
+    rowExpirationDates.erase(rowKeys[row].id);
+    rowKeys.erase(rowKeys.begin() + row);
+    if(row < windowFirstRow)
+        --windowFirstRow;
+    else if(row < windowFirstRow + window.size())
+        window.erase(window.begin() + (row - windowFirstRow));
+    endRemoveRows();
+}
+
+void ProductInstanceModel::onProductsChanged(const FG::data::ProductChanges& changes)
+{
+    for(const auto& [id, kind] : changes.get<data::ProductInstance>().getAll())
+    {
+        const auto row = findRow(id);
+        if(kind == data::ChangeKind::Removed)
+        {
+            if(row)
+                eraseRow(*row);
+            continue;
+        }
+
+        data::EntityPtr<data::ProductInstance> instance;
+        try
+        {
+            instance = db.retrieve<data::ProductInstance>(id);
+        }
+        catch(const std::system_error& error)
+        {
+            if(error.code() != sqlite_orm::orm_error_code::not_found)
+                throw;
+
+            //Instance got removed since, notification about it is still to come
+            if(row)
+                eraseRow(*row);
+            continue;
+        }
+        if(row && keyOf(*instance) == rowKeys[*row])
+        {
+            emit dataChanged(index(static_cast<int>(*row), 0), index(static_cast<int>(*row), ColumnsCount - 1));
+            continue;
+        }
+
+        //Instance whose expiration date changed moves to another row, possibly to one not fetched yet
+        if(row)
+            eraseRow(*row);
+        placeRow(std::move(instance));
+    }
+
+    //Names of changed descriptions may be shown in any row
+    if(!changes.get<data::ProductDescription>().empty() && !rowKeys.empty())
+        emit dataChanged(index(0, NameColumn), index(rowCount() - 1, NameColumn));
+}
+}
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include <memory>
 #include "../generated/UiMainWindow.hpp"
+#include "ProductChangesNotifier.hpp"
+#include "ProductDatabase.hpp"
+#include "ProductInstanceModel.hpp"
 
 namespace FG::Ui
 {
@@ -10,12 +13,16 @@ class MainWindow : public QMainWindow
 Q_OBJECT
 
 public:
-    MainWindow();
+    explicit MainWindow(data::ProductDatabase& database);
 
 private slots:
     void on_someTestButton_clicked();
 
+    void onProductsChanged(const FG::data::ProductChanges& changes);
+
 private:
     std::unique_ptr<::Ui::MainWindow> mainWindow;
+    ProductChangesNotifier changesNotifier;
+    ProductInstanceModel instanceModel;
 };
 }
\ No newline at end of file
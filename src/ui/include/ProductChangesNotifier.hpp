@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+#include <QObject>
+#include "ProductDatabase.hpp"
+
+namespace FG::Ui
+{
+//Turns change notifications of the database into a Qt signal emitted on the thread owning this object, e.g. GUI one.
+//Changes are collected on the thread which writes to the database, which may be a different one,
+//and those reported within one event loop iteration of the owning thread are coalesced into a single emission.
+class ProductChangesNotifier : public QObject
+{
+Q_OBJECT
+
+public:
+    //May be created and destroyed on any thread, in single-threaded build only on the one writing to the database
+    explicit ProductChangesNotifier(data::ProductDatabase& database, QObject* parent = nullptr);
+
+    ~ProductChangesNotifier() override;
+
+signals:
+    void productsChanged(const FG::data::ProductChanges& changes);
+
+private:
+    void collect(const data::ProductChanges& changes);
+
+    void emitCollected();
+
+    data::ProductDatabase& db;
+    //Guards collected changes shared by the writer thread and the owning one
+    std::mutex collectedMutex;
+    data::ProductChanges collected;
+    bool emissionScheduled = false;
+    //Registered last, once everything the listener uses is already constructed
+    const data::ProductDatabase::ListenerId listenerId;
+};
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <QAbstractTableModel>
+#include "ProductChangesNotifier.hpp"
+#include "ProductDatabase.hpp"
+
+namespace FG::Ui
+{
+//Product instances ordered by expiration date, fetched page by page as the view scrolls down.
+//Only keys of fetched rows are kept, entities are held just for a window of rows around the ones lastly shown,
+//so that the rest of them can be evicted from the cache. When database loads FK entities lazily,
+//descriptions are resolved for the whole window at once.
+class ProductInstanceModel : public QAbstractTableModel
+{
+Q_OBJECT
+
+public:
+    enum Column
+    {
+        NameColumn,
+        PurchaseDateColumn,
+        ExpirationDateColumn,
+        OpenColumn,
+        ConsumedColumn,
+        ColumnsCount
+    };
+
+    ProductInstanceModel(data::ProductDatabase& database, ProductChangesNotifier& changesNotifier, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = {}) const override;
+
+    int columnCount(const QModelIndex& parent = {}) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex& parent) const override;
+
+    void fetchMore(const QModelIndex& parent) override;
+
+private:
+    using RowKey = data::PageKey<data::Date>;
+
+    static constexpr std::size_t pageSize = 100;
+    static constexpr std::size_t windowSize = 3 * pageSize;
+
+    //Empty for instance which got removed, but notification about it didn't come yet
+    const data::ProductInstance* instanceAt(std::size_t row) const;
+
+    void moveWindow(std::size_t row) const;
+
+    void setWindow(std::size_t firstRow, std::vector<data::EntityPtr<data::ProductInstance>>&& instances) const;
+
+    std::optional<std::size_t> findRow(data::Id id) const;
+
+    //Row is placed only among fetched rows, otherwise it will come with one of the next pages
+    void placeRow(data::EntityPtr<data::ProductInstance>&& instance);
+
+    void eraseRow(std::size_t row);
+
+    void onProductsChanged(const FG::data::ProductChanges& changes);
+
+    data::ProductDatabase& db;
+    std::vector<RowKey> rowKeys;
+    //Lets rows be found by instance ID with binary search over their keys
+    std::unordered_map<data::Id, data::Date> rowExpirationDates;
+    std::optional<RowKey> nextPageKey;
+    bool fetchedAll = false;
+    //Window is moved by const data(), which is what actually decides about rows being shown
+    mutable std::size_t windowFirstRow = 0;
+    mutable std::vector<data::EntityPtr<data::ProductInstance>> window;
+};
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+//AsyncDatabase hands entities over to other threads, so it's available only in thread safe build
+#ifdef FG_DATA_THREAD_SAFE
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "AsyncProductDatabase.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+struct AsyncProductDatabaseTestFixture : public Test
+{
+    //Keeps worker busy until returned promise is fulfilled, so that following requests get queued together
+    std::promise<void> blockWorker()
+    {
+        std::promise<void> gate;
+        db.execute([released = gate.get_future().share()](ProductDatabase&) { released.wait(); });
+        return gate;
+    }
+
+    void runDispatched()
+    {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard lock(dispatchedMutex);
+            tasks.swap(dispatched);
+        }
+        for(auto& task : tasks)
+            task();
+    }
+
+    std::mutex dispatchedMutex;
+    std::vector<std::function<void()>> dispatched;
+    AsyncProductDatabase db{"", {}, [this](std::function<void()> task) {
+        std::lock_guard lock(dispatchedMutex);
+        dispatched.push_back(std::move(task));
+    }};
+};
+
+TEST_F(AsyncProductDatabaseTestFixture, AsyncProductDatabaseShouldCreateAndRetrieveEntitiesWithFkEntitiesLoaded)
+{
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false).get();
+    auto description = db.create<ProductDescription>(category, "desc", std::nullopt, 3u, std::nullopt, false).get();
+    auto instance = db.create<ProductInstance>(description, isoDateToDate("2024-11-17"), isoDateToDate("2024-12-17"),
+                                               std::nullopt, false, false).get();
+    ASSERT_EQ(1, instance->getId());
+
+    const auto instanceId = instance->getId();
+    instance.reset();
+    description.reset();
+    auto retrieved = db.retrieve<ProductInstance>(instanceId).get();
+    ASSERT_TRUE(retrieved);
+    ASSERT_EQ(isoDateToDate("2024-12-17"), retrieved->expirationDate);
+    ASSERT_TRUE(retrieved->description.isResolved());
+    ASSERT_EQ("desc", retrieved->description->name);
+    ASSERT_EQ(category.get(), retrieved->description->category.get());
+}
+
+TEST_F(AsyncProductDatabaseTestFixture, AsyncProductDatabaseShouldCommitQueuedWritesTogetherAndFailOnlyInvalidOnes)
+{
+    AsyncProductDatabase otherDb;
+    auto foreignCategory = otherDb.create<ProductCategory>("foreign", std::nullopt, false).get();
+
+    auto gate = blockWorker();
+    std::vector<std::future<EntityPtr<ProductCategory>>> created;
+    for(auto i = 0; i < 10; ++i)
+        created.push_back(db.create<ProductCategory>("cat" + std::to_string(i), std::nullopt, false));
+    auto invalidCommit = db.commitChanges(foreignCategory);
+    gate.set_value();
+
+    for(auto i = 0; i < 10; ++i)
+        ASSERT_EQ(i + 1, created[i].get()->getId());
+    ASSERT_THROW(invalidCommit.get(), std::runtime_error);
+    ASSERT_EQ(10, db.retrieveAll<ProductCategory>().get().size());
+}
+
+TEST_F(AsyncProductDatabaseTestFixture, AsyncProductDatabaseShouldApplyChangesAndRemovalsInSubmissionOrder)
+{
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false).get();
+    category->name = "renamed";
+    auto commit = db.commitChanges(category);
+    auto retrieved = db.retrieveAll<ProductCategory>();
+    commit.get();
+    ASSERT_EQ("renamed", retrieved.get().at(0)->name);
+
+    db.remove(std::move(category)).get();
+    ASSERT_TRUE(db.retrieveAll<ProductCategory>().get().empty());
+}
+
+TEST_F(AsyncProductDatabaseTestFixture, AsyncProductDatabaseShouldReleaseDroppedEntitiesWhileIdle)
+{
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false).get();
+    //Lets the worker finish releasing pins after the request, while the entity is still held
+    std::this_thread::sleep_for(AsyncProductDatabase::idlePinReleaseInterval / 2);
+    category.reset();
+    std::this_thread::sleep_for(AsyncProductDatabase::idlePinReleaseInterval * 3);
+
+    //Pins are released after requests are processed as well, so released entities are counted before that
+    auto releasedEntities = db.execute([](ProductDatabase& database) {
+        return database.getAllocationStats<ProductCategory>().releasedEntities;
+    });
+    ASSERT_EQ(1, releasedEntities.get());
+}
+
+TEST_F(AsyncProductDatabaseTestFixture, AsyncProductDatabaseShouldDeliverCallbackResultsThroughDispatcher)
+{
+    std::thread::id callbackThread;
+    std::size_t numOfCategories = 0;
+    db.create<ProductCategory>("cat", std::nullopt, false);
+    db.execute([](ProductDatabase& database) { return database.retrieveAll<ProductCategory>().size(); },
+               [&](std::future<std::size_t> result) {
+                   numOfCategories = result.get();
+                   callbackThread = std::this_thread::get_id();
+               });
+
+    //Any later request completes only after the callback got dispatched
+    db.execute([](ProductDatabase&) {}).get();
+    ASSERT_EQ(0, numOfCategories);
+    runDispatched();
+    ASSERT_EQ(1, numOfCategories);
+    ASSERT_EQ(std::this_thread::get_id(), callbackThread);
+}
+}
+#endif
\ No newline at end of file
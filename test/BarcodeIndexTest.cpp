@@ -0,0 +1,61 @@
+#include <string>
+#include <gtest/gtest.h>
+#include "BarcodeIndex.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+struct BarcodeIndexTestFixture : public Test
+{
+    internal::BarcodeIndex index;
+};
+
+TEST_F(BarcodeIndexTestFixture, BarcodeIndexShouldFindIdsOfDescriptionsWithBarcodes)
+{
+    index.update(1, "5901234123457");
+    index.update(2, std::nullopt);
+    index.update(3, "4006381333931");
+
+    ASSERT_EQ(1, index.find("5901234123457"));
+    ASSERT_EQ(3, index.find(std::string("4006381333931")));
+    ASSERT_FALSE(index.find("0000000000000"));
+    ASSERT_EQ(2, index.size());
+}
+
+TEST_F(BarcodeIndexTestFixture, BarcodeIndexShouldFollowChangesAndRemovalOfBarcodes)
+{
+    index.update(1, "111");
+    index.update(2, "222");
+    index.update(3, "333");
+
+    index.update(1, "444");
+    index.update(2, std::nullopt);
+    index.erase(3);
+    index.erase(5);
+
+    ASSERT_FALSE(index.find("111"));
+    ASSERT_FALSE(index.find("222"));
+    ASSERT_FALSE(index.find("333"));
+    ASSERT_EQ(1, index.find("444"));
+    ASSERT_EQ(1, index.size());
+}
+
+TEST_F(BarcodeIndexTestFixture, BarcodeIndexShouldKeepFindingBarcodeSharedByDescriptionsAsLongAsAnyOfThemHasIt)
+{
+    index.update(7, "111");
+    index.update(2, "111");
+    index.update(5, "111");
+    ASSERT_EQ(2, index.find("111"));
+    ASSERT_EQ(1, index.size());
+
+    index.update(2, "222");
+    ASSERT_EQ(5, index.find("111"));
+    index.erase(5);
+    ASSERT_EQ(7, index.find("111"));
+    index.update(7, std::nullopt);
+    ASSERT_FALSE(index.find("111"));
+    ASSERT_EQ(2, index.find("222"));
+    ASSERT_EQ(1, index.size());
+}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include "ChangeSet.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+namespace
+{
+struct FirstEntity {};
+struct SecondEntity {};
+}
+
+TEST(ChangeSetTest, ChangeSetShouldKeepOnlyChangeWhichMattersForListenersOfEveryEntity)
+{
+    EntityChanges<FirstEntity> changes;
+    changes.add(ChangeKind::Created, 1);
+    changes.add(ChangeKind::Updated, 1);
+    changes.add(ChangeKind::Created, 2);
+    changes.add(ChangeKind::Removed, 2);
+    changes.add(ChangeKind::Updated, 3);
+    changes.add(ChangeKind::Updated, 3);
+    changes.add(ChangeKind::Updated, 4);
+    changes.add(ChangeKind::Removed, 4);
+
+    ASSERT_EQ(std::vector<Id>{1}, changes.getIds(ChangeKind::Created));
+    ASSERT_EQ(std::vector<Id>{3}, changes.getIds(ChangeKind::Updated));
+    ASSERT_EQ(std::vector<Id>{4}, changes.getIds(ChangeKind::Removed));
+    ASSERT_EQ(3, changes.getAll().size());
+}
+
+TEST(ChangeSetTest, ChangeSetShouldMergeChangesOfEachEntityTypeSeparately)
+{
+    ChangeSet<FirstEntity, SecondEntity> changes;
+    ASSERT_TRUE(changes.empty());
+    changes.add<FirstEntity>(ChangeKind::Created, 1);
+    changes.add<SecondEntity>(ChangeKind::Updated, 1);
+
+    ChangeSet<FirstEntity, SecondEntity> laterChanges;
+    laterChanges.add<FirstEntity>(ChangeKind::Removed, 1);
+    laterChanges.add<SecondEntity>(ChangeKind::Removed, 1);
+    laterChanges.add<SecondEntity>(ChangeKind::Created, 2);
+    changes.merge(laterChanges);
+
+    ASSERT_TRUE(changes.get<FirstEntity>().empty());
+    ASSERT_EQ(std::vector<Id>{1}, changes.get<SecondEntity>().getIds(ChangeKind::Removed));
+    ASSERT_EQ(std::vector<Id>{2}, changes.get<SecondEntity>().getIds(ChangeKind::Created));
+    ASSERT_FALSE(changes.empty());
+}
+}
\ No newline at end of file
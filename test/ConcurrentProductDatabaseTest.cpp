@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "ProductDatabase.hpp"
+#include "TempDatabaseFile.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+TEST(ConcurrentProductDatabaseTest, ProductDatabaseShouldServeReadsOnAllCoresWhileWriterCommitsChanges)
+{
+    if constexpr(!internal::threadSafe)
+        GTEST_SKIP() << "Data layer built without FG_DATA_THREAD_SAFE";
+
+    constexpr Id numOfSeededInstances = 200;
+    const TempDatabaseFile dbFile("FridgeGuardConcurrencyTest");
+    const auto& dbFilePath = dbFile.getPath();
+    {
+        ProductDatabase db(dbFilePath, DatabaseOptions::fast());
+        {
+            auto session = db.startSession();
+            auto category = db.create<ProductCategory>("cat", std::nullopt, false);
+            auto description = db.create<ProductDescription>(category, "desc", std::nullopt, 3u, std::nullopt, false);
+            for(Id i = 0; i < numOfSeededInstances; ++i)
+            {
+                db.create<ProductInstance>(description, isoDateToDate("2024-01-01"), Date(isoDateToDate("2024-01-01").getDaysSinceEpoch() + i),
+                                           std::nullopt, false, false);
+            }
+            session.commit();
+        }
+
+        //Readers only look into seeded instances, which the writer never modifies
+        std::atomic<bool> writerDone = false;
+        std::thread writer([&db, &writerDone] {
+            auto description = db.retrieve<ProductDescription>(1);
+            for(auto i = 0; i < 300; ++i)
+            {
+                auto instance = db.create<ProductInstance>(description, isoDateToDate("2030-01-01"), isoDateToDate("2030-06-01"),
+                                                           std::nullopt, false, false);
+                instance->isOpen = true;
+                db.commitChanges(instance);
+                if(i % 2 == 0)
+                    db.remove(std::move(instance));
+            }
+            writerDone = true;
+        });
+
+        const auto numOfReaders = std::max(2u, std::thread::hardware_concurrency());
+        std::vector<std::thread> readers;
+        for(unsigned t = 0; t < numOfReaders; ++t)
+        {
+            readers.emplace_back([&db, &writerDone, t] {
+                std::mt19937 gen(t);
+                std::uniform_int_distribution<Id> idDist(1, numOfSeededInstances);
+                const auto firstExpiration = isoDateToDate("2024-01-01");
+                const auto expirationsEnd = Date(firstExpiration.getDaysSinceEpoch() + numOfSeededInstances);
+                //Every reader does some work even if the writer happens to finish first
+                for(auto i = 0; i < 200 || !writerDone; ++i)
+                {
+                    const auto id = idDist(gen);
+                    auto instance = db.retrieve<ProductInstance>(id);
+                    ASSERT_TRUE(instance);
+                    ASSERT_EQ(Date(firstExpiration.getDaysSinceEpoch() + id - 1), instance->expirationDate);
+                    ASSERT_EQ("desc", instance->description->name);
+
+                    const std::set<Id> ids{id, idDist(gen), idDist(gen)};
+                    ASSERT_EQ(ids.size(), db.retrieve<ProductInstance>(ids).size());
+                    ASSERT_EQ(numOfSeededInstances, db.findExpiring(firstExpiration, expirationsEnd).size());
+                }
+            });
+        }
+
+        writer.join();
+        for(auto& reader : readers)
+            reader.join();
+
+        ASSERT_EQ(numOfSeededInstances + 150, db.retrieveAll<ProductInstance>().size());
+    }
+}
+}
\ No newline at end of file
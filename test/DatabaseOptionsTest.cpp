@@ -0,0 +1,66 @@
+#include <string>
+#include <gtest/gtest.h>
+#include <sqlite3.h>
+#include "DatabaseOptions.hpp"
+#include "TempDatabaseFile.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+namespace
+{
+std::string queryPragma(sqlite3* db, const std::string& pragma)
+{
+    sqlite3_stmt* stmt = nullptr;
+    EXPECT_EQ(SQLITE_OK, sqlite3_prepare_v2(db, ("PRAGMA " + pragma).c_str(), -1, &stmt, nullptr));
+    std::string value;
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+        value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return value;
+}
+}
+
+struct DatabaseOptionsTestFixture : public Test
+{
+    void SetUp() override
+    {
+        ASSERT_EQ(SQLITE_OK, sqlite3_open(dbFile.getPath().c_str(), &db));
+    }
+
+    void TearDown() override
+    {
+        sqlite3_close(db);
+    }
+
+    const TempDatabaseFile dbFile{"FridgeGuardOptionsTest"};
+    sqlite3* db = nullptr;
+};
+
+TEST_F(DatabaseOptionsTestFixture, FastPresetShouldBeAppliedToConnection)
+{
+    internal::applyDatabaseOptions(db, DatabaseOptions::fast());
+    ASSERT_EQ("wal", queryPragma(db, "journal_mode"));
+    ASSERT_EQ("1", queryPragma(db, "synchronous"));
+    ASSERT_EQ("-65536", queryPragma(db, "cache_size"));
+    ASSERT_EQ("2", queryPragma(db, "temp_store"));
+}
+
+TEST_F(DatabaseOptionsTestFixture, DurablePresetShouldBeAppliedToConnection)
+{
+    internal::applyDatabaseOptions(db, DatabaseOptions::durable());
+    ASSERT_EQ("wal", queryPragma(db, "journal_mode"));
+    ASSERT_EQ("2", queryPragma(db, "synchronous"));
+}
+
+TEST_F(DatabaseOptionsTestFixture, DefaultOptionsShouldKeepSqliteDefaults)
+{
+    const auto defaultCacheSize = queryPragma(db, "cache_size");
+    internal::applyDatabaseOptions(db, DatabaseOptions{});
+    ASSERT_EQ("delete", queryPragma(db, "journal_mode"));
+    ASSERT_EQ("2", queryPragma(db, "synchronous"));
+    ASSERT_EQ(defaultCacheSize, queryPragma(db, "cache_size"));
+    ASSERT_EQ("0", queryPragma(db, "temp_store"));
+}
+}
\ No newline at end of file
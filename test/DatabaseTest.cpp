@@ -1,3 +1,13 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
 #include <vector>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -42,13 +52,18 @@ struct TestComplexEntity : public DbEntity<TestComplexSchema>
         : Base(fkEnt, std::move(data)), simpleEntity(fkEnt)
     {}
 
-    void setFkEntity(EntityPtr<const TestSimpleEntity> newFkEntity)
+    void setFkEntity(LazyEntityPtr<const TestSimpleEntity> newFkEntity)
     {
-        simpleEntity = newFkEntity;
-        setFkId(newFkEntity->getId());
+        simpleEntity = std::move(newFkEntity);
+        setFkId(simpleEntity.getId());
     }
 
-    EntityPtr<const TestSimpleEntity> simpleEntity;
+    void updateFkId()
+    {
+        setFkId(simpleEntity.getId());
+    }
+
+    LazyEntityPtr<const TestSimpleEntity> simpleEntity;
 };
 
 template<typename T>
@@ -88,6 +103,12 @@ public:
     MOCK_METHOD(void, removeMock, (TestSimpleEntity&), ());
     MOCK_METHOD(void, removeMock, (TestComplexEntity&), ());
 
+    MOCK_METHOD((std::vector<std::tuple<TestComplexEntity, TestSimpleEntity>>), retrieveJoinedMock, (const std::set<Id>&), ());
+
+    MOCK_METHOD(std::vector<TestSimpleEntity>, retrievePageMock, ((const std::optional<PageKey<int>>&), std::size_t, SortOrder), ());
+
+    MOCK_METHOD(void, transactionMock, (), ());
+
     template<typename EntityT>
     void insertImpl(EntityT& entity)
     {
@@ -119,6 +140,25 @@ public:
         return retrieveAllMock(TypeInd<EntityT>());
     }
 
+    //Joined retrieval is supported only by set of IDs
+    template<typename EntityT>
+    std::vector<std::tuple<TestComplexEntity, TestSimpleEntity>> retrieveJoinedImpl(const std::set<Id>& ids)
+    {
+        return retrieveJoinedMock(ids);
+    }
+
+    template<typename EntityT, typename SortT, typename OrderBy>
+    std::vector<EntityT> retrievePageImpl(const std::optional<PageKey<SortT>>& afterKey, std::size_t limit, OrderBy, SortOrder order)
+    {
+        return retrievePageMock(afterKey, limit, order);
+    }
+
+    template<typename EntityT>
+    std::vector<EntityT> streamImpl()
+    {
+        return retrieveAllMock(TypeInd<EntityT>());
+    }
+
     template<typename EntityT>
     void updateImpl(const EntityT& entity)
     {
@@ -131,6 +171,13 @@ public:
         removeMock(entity);
     }
 
+    template<typename Func>
+    void transactionImpl(Func&& func)
+    {
+        transactionMock();
+        func();
+    }
+
 private:
     Id nextId = 0;
 };
@@ -167,6 +214,152 @@ TEST_F(DatabaseTestFixture, DatabaseShouldReturnComplexEntityWithFkThatWasNotExp
     ASSERT_EQ(entityPtr->simpleEntity.get(), theSameEntityPtr->simpleEntity.get());
 }
 
+TEST_F(DatabaseTestFixture, DatabaseShouldRetrieveFkEntityOnlyWhenLazyHandleIsDereferenced)
+{
+    TestSimpleEntity fkEntityTemplate({});
+    TestComplexEntity entityTemplate({});
+    fkEntityTemplate.setId(exampleFkId);
+    entityTemplate.setId(exampleId);
+    entityTemplate.setFkId(exampleFkId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+
+    db.setFkLoadingPolicy(FkLoadingPolicy::Lazy);
+    auto entityPtr = db.template retrieve<TestComplexEntity>(exampleId);
+    ASSERT_EQ(exampleFkId, entityPtr->getFkId());
+    ASSERT_FALSE(entityPtr->simpleEntity.isResolved());
+    ASSERT_EQ(exampleFkId, entityPtr->simpleEntity.getId());
+
+    expectSingleRetrieveById(exampleFkId, fkEntityTemplate);
+    ASSERT_EQ(exampleFkId, entityPtr->simpleEntity->getId());
+    ASSERT_TRUE(entityPtr->simpleEntity.isResolved());
+    ASSERT_EQ(db.template retrieve<TestSimpleEntity>(exampleFkId).get(), entityPtr->simpleEntity.get());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldResolveLazyHandleDereferencedOnManyThreadsAtOnceToSingleEntity)
+{
+    if constexpr(!internal::threadSafe)
+        GTEST_SKIP() << "Data layer built without FG_DATA_THREAD_SAFE";
+
+    TestSimpleEntity fkEntityTemplate({});
+    TestComplexEntity entityTemplate({});
+    fkEntityTemplate.setId(exampleFkId);
+    entityTemplate.setId(exampleId);
+    entityTemplate.setFkId(exampleFkId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    EXPECT_CALL(db, retrieveSingleMock(exampleFkId, An<TypeInd<TestSimpleEntity>>())).WillRepeatedly(Return(fkEntityTemplate));
+
+    db.setFkLoadingPolicy(FkLoadingPolicy::Lazy);
+    auto entityPtr = db.template retrieve<TestComplexEntity>(exampleId);
+    constexpr auto numOfThreads = 8;
+    std::array<const TestSimpleEntity*, numOfThreads> resolvedEntities{};
+    std::vector<std::thread> threads;
+    for(auto i = 0; i < numOfThreads; ++i)
+        threads.emplace_back([&entityPtr, &resolvedEntities, i] { resolvedEntities[i] = entityPtr->simpleEntity.get(); });
+    for(auto& thread : threads)
+        thread.join();
+
+    ASSERT_NE(nullptr, resolvedEntities.front());
+    ASSERT_TRUE(std::ranges::all_of(resolvedEntities, [&resolvedEntities](const auto* entity) { return entity == resolvedEntities.front(); }));
+    //Only the lazy handle and the one retrieved here keep it referenced, extra references of threads which lost are gone
+    auto fkEntityPtr = db.template retrieve<TestSimpleEntity>(exampleFkId);
+    ASSERT_EQ(resolvedEntities.front(), fkEntityPtr.get());
+    ASSERT_EQ(2, fkEntityPtr.use_count());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldResolveManyLazyHandlesWithSingleQuery)
+{
+    constexpr auto numOfEntities = 6;
+    std::vector<TestComplexEntity> expectedEntities;
+    std::vector<TestSimpleEntity> expectedFkEntities;
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        expectedEntities.emplace_back(TestComplexSchema{i, {}});
+        expectedEntities.back().setId(i);
+        expectedEntities.back().setFkId(10 + i % 3);
+    }
+    for(auto i = 10; i < 13; ++i)
+    {
+        expectedFkEntities.emplace_back(TestSimpleSchema{i, "fk"});
+        expectedFkEntities.back().setId(i);
+    }
+    EXPECT_CALL(db, retrieveAllMock(An<TypeInd<TestComplexEntity>>())).WillOnce(Return(expectedEntities));
+    EXPECT_CALL(db, retrieveMultipleMock(std::set<Id>{10, 11, 12}, An<TypeInd<TestSimpleEntity>>())).WillOnce(Return(expectedFkEntities));
+
+    db.setFkLoadingPolicy(FkLoadingPolicy::Lazy);
+    auto entitiesPtrs = db.template retrieveAll<TestComplexEntity>();
+    db.resolveLazy(entitiesPtrs | std::views::transform([](auto& entityPtr) -> auto& { return entityPtr->simpleEntity; }));
+    for(const auto& entityPtr : entitiesPtrs)
+    {
+        ASSERT_TRUE(entityPtr->simpleEntity.isResolved());
+        ASSERT_EQ(entityPtr->getFkId(), entityPtr->simpleEntity->getId());
+        ASSERT_EQ("fk", entityPtr->simpleEntity->label);
+    }
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldStreamEntitiesResolvingTheirFkEntitiesInBatches)
+{
+    constexpr auto numOfEntities = 600;
+    constexpr auto numOfFkEntities = 1000;
+    std::vector<TestComplexEntity> expectedEntities;
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        expectedEntities.emplace_back(TestComplexSchema{i, {}});
+        expectedEntities.back().setId(i);
+        expectedEntities.back().setFkId(1 + (i * 7) % numOfFkEntities);
+    }
+    EXPECT_CALL(db, retrieveAllMock(An<TypeInd<TestComplexEntity>>())).WillOnce(Return(expectedEntities));
+
+    std::vector<std::size_t> fkBatchSizes;
+    EXPECT_CALL(db, retrieveMultipleMock(An<const std::set<Id>&>(), An<TypeInd<TestSimpleEntity>>()))
+        .Times(3)
+        .WillRepeatedly(Invoke([&fkBatchSizes](const std::set<Id>& ids, auto) {
+            fkBatchSizes.push_back(ids.size());
+            std::vector<TestSimpleEntity> fkEntities;
+            for(Id id : ids)
+            {
+                fkEntities.emplace_back(TestSimpleSchema{id, "fk"});
+                fkEntities.back().setId(id);
+            }
+            return fkEntities;
+        }));
+
+    Id expectedId = 0;
+    for(auto& entityPtr : db.template retrieveStream<TestComplexEntity>())
+    {
+        ASSERT_EQ(++expectedId, entityPtr->getId());
+        ASSERT_EQ(entityPtr->getFkId(), entityPtr->simpleEntity->getId());
+        ASSERT_EQ(entityPtr->getFkId(), entityPtr->simpleEntity->number);
+    }
+    ASSERT_EQ(numOfEntities, expectedId);
+    ASSERT_EQ((std::vector<std::size_t>{256, 256, 88}), fkBatchSizes);
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldReturnKeyOfNextPageOnlyWhenMoreEntitiesRemain)
+{
+    std::vector<TestSimpleEntity> entities;
+    for(auto i = 1; i <= 5; ++i)
+    {
+        entities.emplace_back(TestSimpleSchema{10 * (6 - i), "page"});
+        entities.back().setId(i);
+    }
+    //Every query asks for one entity more than the page holds
+    EXPECT_CALL(db, retrievePageMock(Eq(std::nullopt), 4, SortOrder::Descending))
+        .WillOnce(Return(std::vector<TestSimpleEntity>(entities.begin(), entities.begin() + 4)));
+    EXPECT_CALL(db, retrievePageMock(Eq(PageKey<int>{30, 3}), 3, SortOrder::Descending))
+        .WillOnce(Return(std::vector<TestSimpleEntity>(entities.begin() + 3, entities.end())));
+
+    auto page = db.template retrievePage<TestSimpleEntity>(std::nullopt, 3, &TestSimpleEntity::number, SortOrder::Descending);
+    ASSERT_EQ(3, page.entities.size());
+    ASSERT_EQ((PageKey<int>{30, 3}), page.nextKey);
+
+    //Page filled up by the last entities is known to be the last one
+    auto nextPage = db.template retrievePage<TestSimpleEntity>(page.nextKey, 2, &TestSimpleEntity::number, SortOrder::Descending);
+    ASSERT_EQ(2, nextPage.entities.size());
+    ASSERT_FALSE(nextPage.nextKey);
+    ASSERT_EQ(4, nextPage.entities.front()->getId());
+    ASSERT_EQ(page.entities.front().get(), db.template retrieve<TestSimpleEntity>(1).get());
+}
+
 TEST_F(DatabaseTestFixture, DatabaseShouldReturnEntitiesFromCacheAsLongAsThereAreEntityPtrObjectsKeepingReferencesToThem)
 {
     TestSimpleEntity fkEntityTemplate({});
@@ -281,12 +474,495 @@ TEST_F(DatabaseTestFixture, DatabaseShouldNotOverwriteCachedEntitiesWhenTheyAreR
     ASSERT_NE(entityTemplate.label, entitiesPtrs.front()->label);
 }
 
+TEST_F(DatabaseTestFixture, DatabaseShouldCreateManyEntitiesWithFkEntityInSingleTransaction)
+{
+    constexpr auto numOfEntities = 40;
+    std::vector<TestComplexSchema> schemas(numOfEntities, TestComplexSchema{.optNumber = 7, .optFlag = std::nullopt});
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()));
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, insertMock(An<TestComplexEntity&>())).Times(numOfEntities);
+
+    auto fkEntityPtr = db.template create<TestSimpleEntity>();
+    auto entitiesPtrs = db.template createMany<TestComplexEntity>(fkEntityPtr, schemas);
+    ASSERT_EQ(numOfEntities, entitiesPtrs.size());
+    for(const auto& entityPtr : entitiesPtrs)
+    {
+        ASSERT_EQ(fkEntityPtr->getId(), entityPtr->getFkId());
+        ASSERT_EQ(fkEntityPtr.get(), entityPtr->simpleEntity.get());
+        ASSERT_EQ(7, entityPtr->optNumber);
+        ASSERT_EQ(entityPtr.get(), db.template retrieve<TestComplexEntity>(entityPtr->getId()).get());
+    }
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldNotCacheAnyOfManyEntitiesWhenTheirCreationFails)
+{
+    std::vector<TestSimpleSchema> schemas {{1, "first"}, {2, "second"}, {3, "third"}};
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()))
+        .WillOnce(Return())
+        .WillOnce(Throw(std::runtime_error("Insert failed")));
+
+    ASSERT_THROW(db.template createMany<TestSimpleEntity>(schemas), std::runtime_error);
+
+    TestSimpleEntity entityTemplate(TestSimpleSchema{1, "first"});
+    entityTemplate.setId(1);
+    expectSingleRetrieveById(1, entityTemplate);
+    ASSERT_EQ(1, db.template retrieve<TestSimpleEntity>(1)->getId());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldDeferChangesMadeWithinSessionAndFlushThemInSingleTransactionInDependencyOrder)
+{
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()));
+    auto existingEntityPtr = db.template create<TestSimpleEntity>();
+    EntityPtr<TestSimpleEntity> fkEntityPtr;
+    EntityPtr<TestComplexEntity> entityPtr;
+
+    {
+    auto session = db.startSession();
+    entityPtr = db.template create<TestComplexEntity>(existingEntityPtr);
+    fkEntityPtr = db.template create<TestSimpleEntity>();
+    entityPtr->simpleEntity = fkEntityPtr;
+    db.commitChanges(entityPtr);
+    existingEntityPtr->number = 3;
+    db.commitChanges(existingEntityPtr);
+    existingEntityPtr->number = 4;
+    db.commitChanges(existingEntityPtr);
+    ASSERT_EQ(uninitializedId, entityPtr->getId());
+    ASSERT_EQ(uninitializedId, fkEntityPtr->getId());
+
+    InSequence seq;
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()));
+    EXPECT_CALL(db, insertMock(An<TestComplexEntity&>()));
+    EXPECT_CALL(db, updateMock(An<const TestSimpleEntity&>())).WillOnce([](const auto& e) { ASSERT_EQ(4, e.number); });
+    session.commit();
+    }
+
+    ASSERT_NE(uninitializedId, fkEntityPtr->getId());
+    ASSERT_NE(uninitializedId, entityPtr->getId());
+    ASSERT_EQ(fkEntityPtr->getId(), entityPtr->getFkId());
+    ASSERT_EQ(entityPtr.get(), db.template retrieve<TestComplexEntity>(entityPtr->getId()).get());
+    ASSERT_EQ(fkEntityPtr.get(), db.template retrieve<TestSimpleEntity>(fkEntityPtr->getId()).get());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldNotifyListenerAboutCommittedChangesOnly)
+{
+    std::vector<TestDatabase::Changes> notifications;
+    db.addChangeListener([&notifications](const auto& changes) { notifications.push_back(changes); });
+
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>())).Times(2);
+    EXPECT_CALL(db, updateMock(An<const TestSimpleEntity&>()));
+    EXPECT_CALL(db, removeMock(An<TestSimpleEntity&>()));
+    auto entityPtr = db.template create<TestSimpleEntity>();
+    db.commitChanges(entityPtr);
+    const auto removedId = entityPtr->getId();
+    db.remove(std::move(entityPtr));
+    ASSERT_EQ(3, notifications.size());
+    ASSERT_EQ(std::vector<Id>{removedId}, notifications[0].get<TestSimpleEntity>().getIds(ChangeKind::Created));
+    ASSERT_EQ(std::vector<Id>{removedId}, notifications[1].get<TestSimpleEntity>().getIds(ChangeKind::Updated));
+    ASSERT_EQ(std::vector<Id>{removedId}, notifications[2].get<TestSimpleEntity>().getIds(ChangeKind::Removed));
+
+    //Changes of a session are reported together once it's flushed
+    notifications.clear();
+    EntityPtr<TestSimpleEntity> sessionEntityPtr;
+    {
+    auto session = db.startSession();
+    sessionEntityPtr = db.template create<TestSimpleEntity>();
+    auto droppedEntityPtr = db.template create<TestSimpleEntity>();
+    db.remove(std::move(droppedEntityPtr));
+    db.commitChanges(sessionEntityPtr);
+    ASSERT_TRUE(notifications.empty());
+
+    EXPECT_CALL(db, transactionMock());
+    session.commit();
+    }
+    ASSERT_EQ(1, notifications.size());
+    ASSERT_EQ(std::vector<Id>{sessionEntityPtr->getId()}, notifications[0].get<TestSimpleEntity>().getIds(ChangeKind::Created));
+    ASSERT_EQ(1, notifications[0].get<TestSimpleEntity>().getAll().size());
+    ASSERT_TRUE(notifications[0].get<TestComplexEntity>().empty());
+
+    //Nothing is reported for discarded session
+    notifications.clear();
+    try
+    {
+        auto session = db.startSession();
+        db.template create<TestSimpleEntity>();
+        throw std::runtime_error("Interrupted");
+    }
+    catch(const std::runtime_error&)
+    {}
+    ASSERT_TRUE(notifications.empty());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldNotifyEveryListenerUntilItIsRemoved)
+{
+    std::vector<Id> firstNotifiedIds;
+    std::vector<Id> secondNotifiedIds;
+    const auto firstListenerId = db.addChangeListener([&firstNotifiedIds](const auto& changes) {
+        std::ranges::copy(changes.template get<TestSimpleEntity>().getIds(ChangeKind::Created), std::back_inserter(firstNotifiedIds));
+    });
+    const auto secondListenerId = db.addChangeListener([&secondNotifiedIds](const auto& changes) {
+        std::ranges::copy(changes.template get<TestSimpleEntity>().getIds(ChangeKind::Created), std::back_inserter(secondNotifiedIds));
+    });
+    ASSERT_NE(firstListenerId, secondListenerId);
+
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>())).Times(2);
+    const auto firstId = db.template create<TestSimpleEntity>()->getId();
+    db.removeChangeListener(firstListenerId);
+    const auto secondId = db.template create<TestSimpleEntity>()->getId();
+    ASSERT_EQ(std::vector<Id>{firstId}, firstNotifiedIds);
+    ASSERT_EQ((std::vector<Id>{firstId, secondId}), secondNotifiedIds);
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldDropChangesOfEntitiesCreatedAndRemovedWithinTheSameSession)
+{
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()));
+    auto existingEntityPtr = db.template create<TestSimpleEntity>();
+    const auto existingEntityId = existingEntityPtr->getId();
+    auto secondExistingEntityPtr = existingEntityPtr;
+
+    {
+    auto session = db.startSession();
+    auto entityPtr = db.template create<TestSimpleEntity>();
+    auto secondEntityPtr = entityPtr;
+    db.commitChanges(entityPtr);
+    db.template remove<TestSimpleEntity>(std::move(entityPtr));
+    ASSERT_FALSE(secondEntityPtr->isValid());
+
+    db.commitChanges(existingEntityPtr);
+    db.template remove<TestSimpleEntity>(std::move(existingEntityPtr));
+    ASSERT_TRUE(secondExistingEntityPtr->isValid());
+
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, removeMock(An<TestSimpleEntity&>()));
+    session.commit();
+    }
+
+    ASSERT_FALSE(secondExistingEntityPtr->isValid());
+    EXPECT_CALL(db, retrieveSingleMock(existingEntityId, An<TypeInd<TestSimpleEntity>>())).WillOnce(Throw(std::runtime_error(noEntityInDbErrStr)));
+    ASSERT_THROW(db.template retrieve<TestSimpleEntity>(existingEntityId), std::runtime_error);
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldDiscardSessionChangesWhenExceptionLeavesSessionScope)
+{
+    EntityPtr<TestSimpleEntity> entityPtr;
+    try
+    {
+        auto session = db.startSession();
+        entityPtr = db.template create<TestSimpleEntity>();
+        db.commitChanges(entityPtr);
+        throw std::runtime_error("Interrupted");
+    }
+    catch(const std::runtime_error&)
+    {}
+
+    ASSERT_EQ(uninitializedId, entityPtr->getId());
+    ASSERT_FALSE(entityPtr->isValid());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldDiscardChangesOfSessionEndedWithoutCommitAndEvictUpdatedEntities)
+{
+    TestSimpleEntity entityTemplate({3, "test"});
+    entityTemplate.setId(exampleId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    auto entityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+    EntityPtr<TestSimpleEntity> createdEntityPtr;
+
+    {
+    auto session = db.startSession();
+    createdEntityPtr = db.template create<TestSimpleEntity>();
+    entityPtr->number = 5;
+    db.commitChanges(entityPtr);
+    }
+
+    ASSERT_FALSE(createdEntityPtr->isValid());
+    ASSERT_THROW(db.commitChanges(entityPtr), std::runtime_error);
+
+    //Entity edited within discarded session is retrieved again in its committed state
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    auto retrievedEntityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+    ASSERT_NE(entityPtr.get(), retrievedEntityPtr.get());
+    ASSERT_EQ(3, retrievedEntityPtr->number);
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldRollBackSessionAndInvalidateCreatedEntitiesWhenFlushFails)
+{
+    TestSimpleEntity entityTemplate({3, "test"});
+    entityTemplate.setId(exampleId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    auto updatedEntityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+
+    EntityPtr<TestSimpleEntity> firstEntityPtr;
+    EntityPtr<TestSimpleEntity> secondEntityPtr;
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()))
+        .WillOnce(Return())
+        .WillOnce(Throw(std::runtime_error("Insert failed")));
+
+    ASSERT_THROW({
+        auto session = db.startSession();
+        firstEntityPtr = db.template create<TestSimpleEntity>();
+        secondEntityPtr = db.template create<TestSimpleEntity>();
+        updatedEntityPtr->number = 5;
+        db.commitChanges(updatedEntityPtr);
+        session.commit();
+    }, std::runtime_error);
+
+    ASSERT_FALSE(firstEntityPtr->isValid());
+    ASSERT_FALSE(secondEntityPtr->isValid());
+
+    //Edits rolled back in DB don't stay in cache either
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    auto retrievedEntityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+    ASSERT_NE(updatedEntityPtr.get(), retrievedEntityPtr.get());
+    ASSERT_EQ(3, retrievedEntityPtr->number);
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldFlushOnlyOutermostSession)
+{
+    EntityPtr<TestSimpleEntity> entityPtr;
+    {
+    auto session = db.startSession();
+    {
+    auto nestedSession = db.startSession();
+    entityPtr = db.template create<TestSimpleEntity>();
+    nestedSession.commit();
+    }
+    ASSERT_EQ(uninitializedId, entityPtr->getId());
+
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()));
+    session.commit();
+    }
+
+    ASSERT_NE(uninitializedId, entityPtr->getId());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldRefreshCachedEntitiesWithDataRetrievedFromUnderlyingDbWhenConfiguredSo)
+{
+    TestSimpleEntity entityTemplate({3, "test"});
+    entityTemplate.setId(exampleId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    auto entityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+    entityPtr->number = 5;
+    entityPtr->label = "other test";
+
+    db.setRefreshPolicy(RefreshPolicy::RefreshFromDb);
+    std::vector<TestSimpleEntity> expectedEntities {entityTemplate};
+    EXPECT_CALL(this->db, retrieveFilteredMock(An<FilterTypeInd<TestSimpleEntity>>())).WillRepeatedly(Return(expectedEntities));
+
+    auto entitiesPtrs = this->db.template retrieve<TestSimpleEntity>(FilterTypeInd<TestSimpleEntity>());
+    ASSERT_EQ(1, entitiesPtrs.size());
+    ASSERT_EQ(entityPtr.get(), entitiesPtrs.front().get());
+    ASSERT_EQ(entityTemplate.number, entityPtr->number);
+    ASSERT_EQ(entityTemplate.label, entityPtr->label);
+
+    //Changes pending in session must survive refresh
+    auto session = db.startSession();
+    entityPtr->number = 5;
+    db.commitChanges(entityPtr);
+    entitiesPtrs = this->db.template retrieve<TestSimpleEntity>(FilterTypeInd<TestSimpleEntity>());
+    ASSERT_EQ(entityPtr.get(), entitiesPtrs.front().get());
+    ASSERT_EQ(5, entityPtr->number);
+
+    EXPECT_CALL(db, transactionMock());
+    EXPECT_CALL(db, updateMock(An<const TestSimpleEntity&>()));
+    session.commit();
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldRefreshCachedEntitiesOnlyOnThreadWhichSetRefreshPolicy)
+{
+    if constexpr(!internal::threadSafe)
+        GTEST_SKIP() << "Data layer built without FG_DATA_THREAD_SAFE";
+
+    TestSimpleEntity entityTemplate({3, "test"});
+    entityTemplate.setId(exampleId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+    auto entityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+    entityPtr->number = 5;
+
+    db.setRefreshPolicy(RefreshPolicy::RefreshFromDb);
+    std::vector<TestSimpleEntity> expectedEntities {entityTemplate};
+    EXPECT_CALL(db, retrieveFilteredMock(An<FilterTypeInd<TestSimpleEntity>>())).WillRepeatedly(Return(expectedEntities));
+    std::thread([this] {
+        auto entitiesPtrs = db.template retrieve<TestSimpleEntity>(FilterTypeInd<TestSimpleEntity>());
+        ASSERT_EQ(1, entitiesPtrs.size());
+    }).join();
+    ASSERT_EQ(5, entityPtr->number);
+
+    db.template retrieve<TestSimpleEntity>(FilterTypeInd<TestSimpleEntity>());
+    ASSERT_EQ(entityTemplate.number, entityPtr->number);
+}
+
 TEST_F(DatabaseTestFixture, DatabaseShouldThrowWhenTryingToGetComplexEntityWithFkEntityThatWasNotExplicitlyCreatedAndIsNotPresentInUnderlyingDb)
 {
     EXPECT_CALL(db, retrieveSingleMock(exampleId, An<TypeInd<TestComplexEntity>>())).WillOnce(Throw(std::runtime_error("No entity in DB")));
     ASSERT_THROW(db.template retrieve<TestComplexEntity>(exampleId), std::runtime_error);
 }
 
+TEST_F(DatabaseTestFixture, DatabaseShouldQueryUnderlyingDbOnlyForEntitiesMissingInCacheWhenRetrievingBySetOfIds)
+{
+    constexpr auto numOfEntities = 6;
+    std::vector<EntityPtr<TestSimpleEntity>> cachedEntities(numOfEntities);
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>())).Times(numOfEntities);
+    {
+    std::vector<EntityPtr<TestSimpleEntity>> createdEntities;
+    for(auto i = 0; i < numOfEntities; ++i)
+        createdEntities.push_back(db.template create<TestSimpleEntity>());
+    for(auto i = 0; i < numOfEntities; i += 2)
+        cachedEntities[i] = std::move(createdEntities[i]);
+    }
+
+    std::vector<TestSimpleEntity> missingEntities;
+    for(Id id : {2, 4, 6})
+    {
+        missingEntities.emplace_back(TestSimpleSchema{id, "missing"});
+        missingEntities.back().setId(id);
+    }
+    EXPECT_CALL(db, retrieveMultipleMock(std::set<Id>{2, 4, 6}, An<TypeInd<TestSimpleEntity>>())).WillOnce(Return(missingEntities));
+
+    std::set<Id> ids {1, 2, 3, 4, 5, 6};
+    auto entitiesPtrs = db.template retrieve<TestSimpleEntity>(ids);
+    ASSERT_EQ(numOfEntities, entitiesPtrs.size());
+    for(auto i = 0; i < numOfEntities; ++i)
+    {
+        ASSERT_EQ(i + 1, entitiesPtrs[i]->getId());
+        if(cachedEntities[i])
+            ASSERT_EQ(cachedEntities[i].get(), entitiesPtrs[i].get());
+        else
+            ASSERT_EQ("missing", entitiesPtrs[i]->label);
+    }
+
+    auto theSameEntitiesPtrs = db.template retrieve<TestSimpleEntity>(ids);
+    ASSERT_EQ(numOfEntities, theSameEntitiesPtrs.size());
+    for(auto i = 0; i < numOfEntities; ++i)
+        ASSERT_EQ(entitiesPtrs[i].get(), theSameEntitiesPtrs[i].get());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldOrderEntitiesRetrievedBySetOfIdsEvenIfUnderlyingDbReturnsThemUnordered)
+{
+    std::vector<TestSimpleEntity> unorderedEntities;
+    for(Id id : {5, 2, 9, 1})
+    {
+        unorderedEntities.emplace_back(TestSimpleSchema{id, "unordered"});
+        unorderedEntities.back().setId(id);
+    }
+    EXPECT_CALL(db, retrieveMultipleMock(std::set<Id>{1, 2, 5, 9}, An<TypeInd<TestSimpleEntity>>())).WillOnce(Return(unorderedEntities));
+
+    auto entitiesPtrs = db.template retrieve<TestSimpleEntity>(std::set<Id>{1, 2, 5, 9});
+    ASSERT_EQ(4, entitiesPtrs.size());
+    ASSERT_TRUE(std::ranges::is_sorted(entitiesPtrs, std::less{}, [](const auto& entityPtr) { return entityPtr->getId(); }));
+    ASSERT_EQ(1, entitiesPtrs.front()->getId());
+    ASSERT_EQ(9, entitiesPtrs.back()->getId());
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldRetrieveEntitiesAlongWithTheirFkEntitiesInSingleQueryWhenJoiningIsEnabled)
+{
+    constexpr auto numOfEntities = 6;
+    std::vector<std::tuple<TestComplexEntity, TestSimpleEntity>> joinedRows;
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        TestComplexEntity entity(TestComplexSchema{i, {}});
+        entity.setId(i);
+        entity.setFkId(10 + i % 3);
+        TestSimpleEntity fkEntity(TestSimpleSchema{10 + i % 3, "joined"});
+        fkEntity.setId(10 + i % 3);
+        joinedRows.emplace_back(entity, fkEntity);
+    }
+    const std::set<Id> ids{1, 2, 3, 4, 5, 6};
+    EXPECT_CALL(db, retrieveJoinedMock(ids)).WillOnce(Return(joinedRows));
+
+    db.setFkLoadingPolicy(FkLoadingPolicy::Joined);
+    auto entitiesPtrs = db.template retrieve<TestComplexEntity>(ids);
+    ASSERT_EQ(numOfEntities, entitiesPtrs.size());
+    for(const auto& entityPtr : entitiesPtrs)
+    {
+        ASSERT_TRUE(entityPtr->simpleEntity.isResolved());
+        ASSERT_EQ(entityPtr->getFkId(), entityPtr->simpleEntity->getId());
+        ASSERT_EQ("joined", entityPtr->simpleEntity->label);
+    }
+    //Rows sharing FK entity point to the same cached object, which is found in cache later on
+    ASSERT_EQ(entitiesPtrs[0]->simpleEntity.get(), entitiesPtrs[3]->simpleEntity.get());
+    ASSERT_EQ(entitiesPtrs[0]->simpleEntity.get(), db.template retrieve<TestSimpleEntity>(entitiesPtrs[0]->getFkId()).get());
+
+    //Retrievals which implementation can't join fall back to separate query for FK entities
+    std::vector<TestComplexEntity> entities(1, std::get<0>(joinedRows.front()));
+    entities.front().setFkId(20);
+    TestSimpleEntity otherFkEntity(TestSimpleSchema{20, "separate"});
+    otherFkEntity.setId(20);
+    entitiesPtrs.clear();
+    EXPECT_CALL(db, retrieveAllMock(An<TypeInd<TestComplexEntity>>())).WillOnce(Return(entities));
+    EXPECT_CALL(db, retrieveMultipleMock(std::set<Id>{20}, An<TypeInd<TestSimpleEntity>>()))
+        .WillOnce(Return(std::vector<TestSimpleEntity>{otherFkEntity}));
+    auto otherEntitiesPtrs = db.template retrieveAll<TestComplexEntity>();
+    ASSERT_EQ(1, otherEntitiesPtrs.size());
+    ASSERT_EQ("separate", otherEntitiesPtrs.front()->simpleEntity->label);
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldAllocateEntitiesFromArenaOnlyWithinArenaScope)
+{
+    constexpr auto numOfEntities = 50;
+    std::vector<TestSimpleEntity> expectedEntities;
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        expectedEntities.emplace_back(TestSimpleSchema{i, "arena"});
+        expectedEntities.back().setId(i);
+    }
+    EXPECT_CALL(db, retrieveAllMock(An<TypeInd<TestSimpleEntity>>())).WillOnce(Return(expectedEntities));
+    EXPECT_CALL(db, insertMock(An<TestSimpleEntity&>()));
+
+    std::array<std::byte, 64 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    auto isInArena = [&buffer](const auto& entityPtr) {
+        const auto* address = reinterpret_cast<const std::byte*>(entityPtr.get());
+        return address >= buffer.data() && address < buffer.data() + buffer.size();
+    };
+
+    std::vector<EntityPtr<TestSimpleEntity>> entitiesPtrs;
+    {
+    auto arenaScope = db.useArena(arena);
+    entitiesPtrs = db.template retrieveAll<TestSimpleEntity>();
+    }
+    auto entityPtr = db.template create<TestSimpleEntity>();
+
+    ASSERT_EQ(numOfEntities, entitiesPtrs.size());
+    ASSERT_TRUE(std::ranges::all_of(entitiesPtrs, isInArena));
+    ASSERT_FALSE(isInArena(entityPtr));
+
+    const auto& stats = db.template getAllocationStats<TestSimpleEntity>();
+    ASSERT_EQ(numOfEntities + 1, stats.allocatedEntities);
+    ASSERT_EQ(numOfEntities, stats.arenaAllocatedEntities);
+
+    //Entities retrieved within the scope are not returned from cache after it ends, even though they are still alive
+    //ID 1 got assigned to the entity created after the scope
+    expectSingleRetrieveById(2, expectedEntities[1]);
+    auto retrievedEntityPtr = db.template retrieve<TestSimpleEntity>(2);
+    ASSERT_FALSE(isInArena(retrievedEntityPtr));
+    ASSERT_NE(entitiesPtrs[1], retrievedEntityPtr);
+    ASSERT_EQ(retrievedEntityPtr, db.template retrieve<TestSimpleEntity>(2));
+
+    entitiesPtrs.clear();
+    ASSERT_EQ(numOfEntities, stats.releasedEntities);
+    ASSERT_EQ(retrievedEntityPtr, db.template retrieve<TestSimpleEntity>(2));
+}
+
+TEST_F(DatabaseTestFixture, DatabaseShouldRejectNestedArenaScopeAndKeepOuterOneIntact)
+{
+    TestSimpleEntity entityTemplate({3, "arena"});
+    entityTemplate.setId(exampleId);
+    expectSingleRetrieveById(exampleId, entityTemplate);
+
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::monotonic_buffer_resource otherArena;
+    auto arenaScope = db.useArena(arena);
+    auto entityPtr = db.template retrieve<TestSimpleEntity>(exampleId);
+    ASSERT_THROW(db.useArena(otherArena), std::logic_error);
+
+    //Entity retrieved within the outer scope is still found in cache
+    ASSERT_EQ(entityPtr, db.template retrieve<TestSimpleEntity>(exampleId));
+    ASSERT_EQ(1, db.template getAllocationStats<TestSimpleEntity>().arenaAllocatedEntities);
+}
+
 template<typename T>
 struct TypedDatabaseTestFixture : DatabaseTestFixture
 {};
@@ -371,6 +1047,22 @@ TYPED_TEST(TypedDatabaseTestFixture, DatabaseShouldAllowForCachingManyEntitiesWi
         ASSERT_EQ(i, entities[i - 1]->getId());
 }
 
+TYPED_TEST(TypedDatabaseTestFixture, DatabaseShouldCreateManyEntitiesInSingleTransactionAndCacheAllOfThem)
+{
+    constexpr auto numOfEntities = 1000;
+    std::vector<typename TypeParam::SchemaType> schemas(numOfEntities);
+    EXPECT_CALL(this->db, transactionMock());
+    EXPECT_CALL(this->db, insertMock(An<TypeParam&>())).Times(numOfEntities);
+
+    auto entitiesPtrs = this->db.template createMany<TypeParam>(schemas);
+    ASSERT_EQ(numOfEntities, entitiesPtrs.size());
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        ASSERT_EQ(i, entitiesPtrs[i - 1]->getId());
+        ASSERT_EQ(entitiesPtrs[i - 1].get(), this->db.template retrieve<TypeParam>(i).get());
+    }
+}
+
 TYPED_TEST(TypedDatabaseTestFixture, DatabaseShouldForwardEntityUpdateRequestToUnderlyingDb)
 {
     EXPECT_CALL(this->db, insertMock(An<TypeParam&>()));
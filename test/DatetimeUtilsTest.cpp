@@ -1,5 +1,8 @@
+#include <array>
+#include <stdexcept>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "DatetimeUtils.hpp"
@@ -61,10 +64,59 @@ TEST_P(DatetimeUtilsTestFixture, parseIsoDateShouldReturnValidDatetimeObjecsForD
     ASSERT_EQ(expected, actual);
 }
 
+TEST_P(DatetimeUtilsTestFixture, isoDateToDateShouldReturnDaysSinceEpochForDatesFollowingEpoch)
+{
+    auto expected = std::get<Datetime>(GetParam());
+    auto actual = isoDateToDate(std::get<Str>(GetParam()));
+    ASSERT_EQ(expected, actual.toDatetime());
+    ASSERT_EQ(std::get<Timestamp>(GetParam()) / 86400, actual.getDaysSinceEpoch());
+}
+
 INSTANTIATE_TEST_SUITE_P(DatetimeUtilsTest, DatetimeUtilsTestFixture, Values(
     makeDates("1970-01-01", 0,           YMD(1970y,  1m, 1d)),
     makeDates("2024-11-17", 1731801600,  YMD(2024y, 11m, 17d)),
     makeDates("2038-01-19", 2147472000,  YMD(2038y,  1m, 19d)),
     makeDates("2106-02-07", 4294944000,  YMD(2106y,  2m,  7d))
 ));
+
+TEST(DatetimeUtilsTest, isoDateToTimestampShouldParseFullIsoDatetimes)
+{
+    constexpr Timestamp midnight = 1731801600;
+    ASSERT_EQ(midnight, isoDateToTimestamp("2024-11-17T00:00:00"));
+    ASSERT_EQ(midnight + 13 * 3600 + 5 * 60 + 9, isoDateToTimestamp("2024-11-17T13:05:09"));
+    ASSERT_EQ(midnight + 13 * 3600 + 5 * 60 + 9, isoDateToTimestamp("2024-11-17 13:05:09.750Z"));
+    ASSERT_EQ(midnight + 11 * 3600, isoDateToTimestamp("2024-11-17T13:00:00+02:00"));
+    ASSERT_EQ(midnight + 30 * 60, isoDateToTimestamp("2024-11-17T00:00:00-00:30"));
+    ASSERT_EQ(951782400, isoDateToTimestamp("2000-02-29"));
+}
+
+TEST(DatetimeUtilsTest, DateShouldTruncateTimeOfDayTowardsEarlierDay)
+{
+    ASSERT_EQ(Date(YMD(2024y, 11m, 17d)), isoDateToDate("2024-11-17T23:59:59"));
+    ASSERT_EQ(Date(YMD(2024y, 11m, 16d)), isoDateToDate("2024-11-17T00:30:00+01:00"));
+    ASSERT_EQ(Date(-1), Date::fromDatetime(unixTimestampToDatetime(-1)));
+    ASSERT_LT(isoDateToDate("2024-11-17"), isoDateToDate("2024-11-18"));
+}
+
+TEST(DatetimeUtilsTest, isoDateToTimestampShouldRejectMalformedOrInvalidDates)
+{
+    for(Str invalid : {"", "2024", "2024-11", "2024-1-17", "2024/11/17", "2024-11-17x", "2024-13-01", "2024-00-10",
+                       "2023-02-29", "2024-04-31", "2024-11-17T", "2024-11-17T24:00:00", "2024-11-17T12:60:00",
+                       "2024-11-17T12:00", "2024-11-17T12:00:00.", "2024-11-17T12:00:00+0200", "2024-11-17T12:00:00Zs",
+                       "+024-11-17", "2024-11- 7"})
+        ASSERT_THROW(isoDateToTimestamp(invalid), std::runtime_error) << invalid;
+}
+
+TEST(DatetimeUtilsTest, isoDatesToTimestampsShouldParseAllDatesOfSpan)
+{
+    const std::array<Str, 3> dates {"1970-01-01", "2024-11-17", "2038-01-19T03:14:07Z"};
+    std::vector<Timestamp> timestamps(dates.size());
+    isoDatesToTimestamps(dates, timestamps);
+    ASSERT_EQ((std::vector<Timestamp>{0, 1731801600, 2147483647}), timestamps);
+
+    std::vector<Timestamp> tooFewTimestamps(2);
+    ASSERT_THROW(isoDatesToTimestamps(dates, tooFewTimestamps), std::invalid_argument);
+    const std::array<Str, 2> withInvalidDate {"2024-11-17", "2024-02-30"};
+    ASSERT_THROW(isoDatesToTimestamps(withInvalidDate, tooFewTimestamps), std::runtime_error);
+}
 }
\ No newline at end of file
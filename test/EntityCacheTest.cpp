@@ -0,0 +1,291 @@
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "DbEntity.hpp"
+#include "EntityCache.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+namespace
+{
+struct TestSchema
+{
+    int number;
+};
+using TestEntity = DbEntity<TestSchema>;
+}
+
+struct EntityCacheTestFixture : public Test
+{
+    EntityPtr<TestEntity> makeEntity(Id id)
+    {
+        EntityPtr<TestEntity> entity(cache.make(TestSchema{id}));
+        if(id != uninitializedId)
+            entity->setId(id);
+        return entity;
+    }
+
+    internal::EntityCache<TestEntity> cache;
+};
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldFindInsertedEntitiesByIdAndByPointer)
+{
+    constexpr auto numOfEntities = 1000;
+    std::vector<EntityPtr<TestEntity>> entities;
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        entities.push_back(makeEntity(i));
+        auto [entityIt, inserted] = cache.insert(entities.back().get());
+        ASSERT_TRUE(inserted);
+        ASSERT_EQ(entities.back().get(), *entityIt);
+    }
+
+    ASSERT_EQ(numOfEntities, cache.size());
+    for(const auto& entity : entities)
+    {
+        auto entityIt = cache.find(entity->getId());
+        ASSERT_NE(cache.end(), entityIt);
+        ASSERT_EQ(entity.get(), *entityIt);
+        ASSERT_TRUE(cache.contains(entity.get()));
+    }
+    ASSERT_EQ(cache.end(), cache.find(numOfEntities + 1));
+    ASSERT_EQ(cache.end(), cache.find(uninitializedId));
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldNotReplaceEntityWithTheSameIdAlreadyPresentInCache)
+{
+    auto entity = makeEntity(7);
+    auto otherEntity = makeEntity(7);
+    cache.insert(entity.get());
+
+    auto [entityIt, inserted] = cache.insert(otherEntity.get());
+    ASSERT_FALSE(inserted);
+    ASSERT_EQ(entity.get(), *entityIt);
+    ASSERT_FALSE(cache.contains(otherEntity.get()));
+
+    otherEntity.reset();
+    ASSERT_EQ(entity.get(), *cache.find(7));
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldKeepStagedEntitiesUntilTheyAreInsertedWithTheirIds)
+{
+    auto firstEntity = makeEntity(uninitializedId);
+    auto secondEntity = makeEntity(uninitializedId);
+    cache.stage(firstEntity.get());
+    cache.stage(secondEntity.get());
+    ASSERT_TRUE(cache.contains(firstEntity.get()));
+    ASSERT_TRUE(cache.contains(secondEntity.get()));
+    ASSERT_TRUE(cache.empty());
+
+    firstEntity->setId(3);
+    cache.insert(firstEntity.get());
+    ASSERT_EQ(1, cache.size());
+    ASSERT_EQ(firstEntity.get(), *cache.find(3));
+
+    cache.erase(secondEntity.get());
+    ASSERT_FALSE(cache.contains(secondEntity.get()));
+    ASSERT_EQ(1, firstEntity.use_count());
+    ASSERT_EQ(1, secondEntity.use_count());
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldStageEntitiesInsertedWithoutIdInsteadOfMappingThem)
+{
+    auto entity = makeEntity(uninitializedId);
+    auto otherEntity = makeEntity(uninitializedId);
+    cache.insert(entity.get());
+    ASSERT_EQ(otherEntity, cache.insertOrAcquire(otherEntity));
+
+    ASSERT_TRUE(cache.empty());
+    ASSERT_TRUE(cache.contains(entity.get()));
+    ASSERT_TRUE(cache.contains(otherEntity.get()));
+    ASSERT_EQ(cache.end(), cache.find(uninitializedId));
+
+    entity->setId(1);
+    cache.insert(entity.get());
+    ASSERT_EQ(1, cache.size());
+    ASSERT_EQ(entity.get(), *cache.find(1));
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldEvictEntityWhenLastEntityPtrIsGone)
+{
+    auto entity = makeEntity(5);
+    cache.insert(entity.get());
+    auto entityCopy = entity;
+    EntityPtr<const TestEntity> constEntity = entity;
+    ASSERT_EQ(3, entity.use_count());
+
+    entity.reset();
+    entityCopy = nullptr;
+    ASSERT_EQ(1, cache.size());
+    ASSERT_EQ(1, constEntity.use_count());
+
+    constEntity.reset();
+    ASSERT_TRUE(cache.empty());
+    ASSERT_EQ(cache.end(), cache.find(5));
+}
+
+TEST_F(EntityCacheTestFixture, EntityPtrShouldBeResetOnlyIfItIsTheLastOneOnRequest)
+{
+    auto entity = makeEntity(5);
+    cache.insert(entity.get());
+    auto acquiredEntity = cache.acquire(5);
+    ASSERT_FALSE(entity.resetIfLast());
+    ASSERT_TRUE(entity);
+    ASSERT_EQ(2, entity.use_count());
+
+    acquiredEntity.reset();
+    ASSERT_TRUE(entity.resetIfLast());
+    ASSERT_FALSE(entity);
+    ASSERT_TRUE(cache.empty());
+    ASSERT_FALSE(cache.acquire(5));
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldAllocateEntitiesFromPoolInsteadOfOneByOne)
+{
+    constexpr std::size_t numOfEntities = 10'000;
+    std::vector<EntityPtr<TestEntity>> entities;
+    for(std::size_t i = 1; i <= numOfEntities; ++i)
+        entities.push_back(makeEntity(i));
+
+    const auto& stats = cache.getAllocationStats();
+    ASSERT_EQ(numOfEntities, stats.allocatedEntities);
+    ASSERT_EQ(0, stats.arenaAllocatedEntities);
+    ASSERT_LT(stats.upstreamAllocations, numOfEntities / 100);
+
+    entities.clear();
+    ASSERT_EQ(numOfEntities, stats.releasedEntities);
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldMapArenaEntitiesOnlyForThreadWhichSetArenaUntilItIsUnset)
+{
+    std::array<std::byte, 4 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    cache.setArena(&arena);
+    auto arenaEntity = makeEntity(1);
+    cache.insert(arenaEntity.get());
+    ASSERT_EQ(arenaEntity, cache.acquire(1));
+    ASSERT_TRUE(cache.contains(arenaEntity.get()));
+    ASSERT_EQ(cache.end(), cache.find(1));
+
+    if constexpr(internal::threadSafe)
+    {
+        std::thread([this] {
+            ASSERT_FALSE(cache.acquire(1));
+            auto entity = makeEntity(2);
+            ASSERT_EQ(1, cache.getAllocationStats().arenaAllocatedEntities);
+        }).join();
+    }
+
+    cache.setArena(nullptr);
+    ASSERT_FALSE(cache.acquire(1));
+    ASSERT_FALSE(cache.contains(arenaEntity.get()));
+
+    //Arena entity released after its arena got unset doesn't affect entity cached under the same ID
+    auto entity = makeEntity(1);
+    cache.insert(entity.get());
+    arenaEntity.reset();
+    ASSERT_EQ(entity, cache.acquire(1));
+}
+
+TEST(EntityCacheTest, EntityShouldOutliveCacheAsLongAsItIsReferenced)
+{
+    EntityPtr<TestEntity> entity;
+    {
+        internal::EntityCache<TestEntity> cache;
+        entity = EntityPtr<TestEntity>(cache.make(TestSchema{42}));
+        entity->setId(1);
+        cache.insert(entity.get());
+    }
+
+    ASSERT_EQ(42, entity->number);
+    ASSERT_EQ(1, entity.use_count());
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldStayConsistentWithReferenceMapUnderRandomInsertionsAndRemovals)
+{
+    std::map<Id, EntityPtr<TestEntity>> reference;
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<Id> idDist(1, 5000);
+    for(auto i = 0; i < 100'000; ++i)
+    {
+        const auto id = idDist(gen);
+        auto refIt = reference.find(id);
+        if(refIt == reference.end())
+        {
+            auto entity = makeEntity(id);
+            cache.insert(entity.get());
+            reference.emplace(id, std::move(entity));
+        }
+        else
+        {
+            //Dropping the last reference evicts entity from cache
+            reference.erase(refIt);
+        }
+    }
+
+    ASSERT_EQ(reference.size(), cache.size());
+    for(Id id = 1; id <= 5000; ++id)
+    {
+        auto refIt = reference.find(id);
+        auto entityIt = cache.find(id);
+        if(refIt == reference.end())
+            ASSERT_EQ(cache.end(), entityIt);
+        else
+            ASSERT_EQ(refIt->second.get(), *entityIt);
+    }
+
+    std::size_t iteratedCount = 0;
+    for(const auto* entity : cache)
+    {
+        ASSERT_TRUE(reference.contains(entity->getId()));
+        ++iteratedCount;
+    }
+    ASSERT_EQ(reference.size(), iteratedCount);
+}
+
+TEST_F(EntityCacheTestFixture, EntityCacheShouldStayConsistentWhenEntitiesAreAcquiredAndReleasedOnAllCores)
+{
+    if constexpr(!internal::threadSafe)
+        GTEST_SKIP() << "Data layer built without FG_DATA_THREAD_SAFE";
+
+    constexpr Id numOfIds = 64;
+    const auto numOfThreads = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < numOfThreads; ++t)
+    {
+        threads.emplace_back([this, t] {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<Id> idDist(1, numOfIds);
+            std::vector<EntityPtr<TestEntity>> held;
+            for(auto i = 0; i < 20'000; ++i)
+            {
+                const auto id = idDist(gen);
+                auto entity = cache.acquire(id);
+                if(!entity)
+                    entity = cache.insertOrAcquire(makeEntity(id));
+                ASSERT_EQ(id, entity->getId());
+                ASSERT_EQ(static_cast<int>(id), entity->number);
+
+                //Keeping some of the entities lets the others race with their eviction
+                if(gen() % 4 == 0)
+                    held.push_back(std::move(entity));
+                if(held.size() > 8)
+                    held.erase(held.begin());
+            }
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+
+    ASSERT_TRUE(cache.empty());
+    const auto& stats = cache.getAllocationStats();
+    ASSERT_EQ(stats.allocatedEntities, stats.releasedEntities);
+}
+}
\ No newline at end of file
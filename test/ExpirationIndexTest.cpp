@@ -0,0 +1,53 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include "ExpirationIndex.hpp"
+
+using namespace testing;
+
+namespace FG::data::test
+{
+struct ExpirationIndexTestFixture : public Test
+{
+    internal::ExpirationIndex index;
+};
+
+TEST_F(ExpirationIndexTestFixture, ExpirationIndexShouldReturnEntriesWithinRangeOrderedByExpirationDate)
+{
+    index.update(1, Date(300), false);
+    index.update(2, Date(100), false);
+    index.update(3, Date(200), false);
+    index.update(4, Date(200), false);
+    index.update(5, Date(400), false);
+
+    const std::vector<ExpirationEntry> expected {{Date(200), 3}, {Date(200), 4}, {Date(300), 1}};
+    ASSERT_EQ(expected, index.findBetween(Date(150), Date(400)));
+    ASSERT_TRUE(index.findBetween(Date(401), Date(1000)).empty());
+}
+
+TEST_F(ExpirationIndexTestFixture, ExpirationIndexShouldReturnSoonestEntriesNotEarlierThanGivenDate)
+{
+    for(Id id = 1; id <= 100; ++id)
+        index.update(id, Date(1000 - id), false);
+
+    const std::vector<ExpirationEntry> expected {{Date(900), 100}, {Date(901), 99}, {Date(902), 98}};
+    ASSERT_EQ(expected, index.findSoonest(3));
+    const std::vector<ExpirationEntry> expectedFrom {{Date(950), 50}, {Date(951), 49}};
+    ASSERT_EQ(expectedFrom, index.findSoonest(2, Date(950)));
+}
+
+TEST_F(ExpirationIndexTestFixture, ExpirationIndexShouldFollowChangesOfExpirationDateAndConsumption)
+{
+    index.update(1, Date(100), false);
+    index.update(2, Date(200), false);
+    index.update(3, Date(300), false);
+
+    index.update(1, Date(250), false);
+    index.update(2, Date(200), true);
+    index.erase(3);
+    index.erase(4);
+
+    const std::vector<ExpirationEntry> expected {{Date(250), 1}};
+    ASSERT_EQ(expected, index.findBetween(Date(0), Date(1000)));
+    ASSERT_EQ(1, index.size());
+}
+}
\ No newline at end of file
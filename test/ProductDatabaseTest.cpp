@@ -1,6 +1,14 @@
+#include <algorithm>
 #include <array>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
 #include <gtest/gtest.h>
 #include "ProductDatabase.hpp"
+#include "TempDatabaseFile.hpp"
 
 using namespace testing;
 
@@ -22,32 +30,87 @@ namespace
 
     std::array sampleProductInstances = {
         ProductInstance({
-            .purchaseDate = parseIsoDate("2023-01-17"), .expirationDate = parseIsoDate("2024-12-31"),
+            .purchaseDate = isoDateToDate("2023-01-17"), .expirationDate = isoDateToDate("2024-12-31"),
             .daysToExpireWhenOpened = 3, .isOpen = true, .isConsumed = true }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2024-11-17"), .expirationDate = parseIsoDate("2024-12-17"),
+            .purchaseDate = isoDateToDate("2024-11-17"), .expirationDate = isoDateToDate("2024-12-17"),
             .daysToExpireWhenOpened = 3, .isOpen = true, .isConsumed = false }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2022-02-25"), .expirationDate = parseIsoDate("2023-02-01"),
+            .purchaseDate = isoDateToDate("2022-02-25"), .expirationDate = isoDateToDate("2023-02-01"),
             .daysToExpireWhenOpened = 2, .isOpen = false, .isConsumed = true }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2024-11-01"), .expirationDate = parseIsoDate("2024-12-15"),
+            .purchaseDate = isoDateToDate("2024-11-01"), .expirationDate = isoDateToDate("2024-12-15"),
             .daysToExpireWhenOpened = 2, .isOpen = false, .isConsumed = false }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2021-06-19"), .expirationDate = parseIsoDate("2021-12-31"),
+            .purchaseDate = isoDateToDate("2021-06-19"), .expirationDate = isoDateToDate("2021-12-31"),
             .daysToExpireWhenOpened = std::nullopt, .isOpen = true, .isConsumed = true }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2024-10-11"), .expirationDate = parseIsoDate("2024-11-25"),
+            .purchaseDate = isoDateToDate("2024-10-11"), .expirationDate = isoDateToDate("2024-11-25"),
             .daysToExpireWhenOpened = std::nullopt, .isOpen = true, .isConsumed = false }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2024-10-12"), .expirationDate = parseIsoDate("2024-10-22"),
+            .purchaseDate = isoDateToDate("2024-10-12"), .expirationDate = isoDateToDate("2024-10-22"),
             .daysToExpireWhenOpened = std::nullopt, .isOpen = false, .isConsumed = true }),
         ProductInstance({
-            .purchaseDate = parseIsoDate("2024-11-17"), .expirationDate = parseIsoDate("2024-12-17"),
+            .purchaseDate = isoDateToDate("2024-11-17"), .expirationDate = isoDateToDate("2024-12-17"),
             .daysToExpireWhenOpened = std::nullopt, .isOpen = false, .isConsumed = false })
     };
 }
 
+//Runs EXPLAIN QUERY PLAN for SQL of given prepared statement and returns its details column
+template<typename StatementT>
+std::vector<std::string> explainQueryPlan(const StatementT& statement)
+{
+    const auto sql = "EXPLAIN QUERY PLAN " + statement.sql();
+    sqlite3_stmt* explainStmt = nullptr;
+    if(sqlite3_prepare_v2(sqlite3_db_handle(statement.stmt), sql.c_str(), -1, &explainStmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error("Could not explain query: " + statement.sql());
+
+    std::vector<std::string> details;
+    while(sqlite3_step(explainStmt) == SQLITE_ROW)
+        details.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(explainStmt, 3)));
+    sqlite3_finalize(explainStmt);
+    return details;
+}
+
+//Index scans are allowed only when asked for, e.g. for ORDER BY + LIMIT query which walks an index in order
+template<typename StatementT>
+void assertQueryDoesNotScanTable(const StatementT& statement, bool allowIndexScan = false)
+{
+    const auto details = explainQueryPlan(statement);
+    ASSERT_FALSE(details.empty());
+    for(const auto& detail : details)
+    {
+        if(!detail.starts_with("SCAN"))
+            continue;
+        const bool isIndexScan = detail.find(" USING INDEX ") != std::string::npos ||
+            detail.find(" USING COVERING INDEX ") != std::string::npos;
+        ASSERT_TRUE(allowIndexScan && isIndexScan) << statement.sql() << ": " << detail;
+    }
+}
+
+namespace
+{
+//Set by SQLite, which hands every newly opened connection to registered auto extensions
+sqlite3* lastOpenedConnection = nullptr;
+
+int captureOpenedConnection(sqlite3* db, const char**, const sqlite3_api_routines*)
+{
+    lastOpenedConnection = db;
+    return SQLITE_OK;
+}
+
+std::string queryPragma(sqlite3* db, const std::string& pragma)
+{
+    sqlite3_stmt* stmt = nullptr;
+    EXPECT_EQ(SQLITE_OK, sqlite3_prepare_v2(db, ("PRAGMA " + pragma).c_str(), -1, &stmt, nullptr));
+    std::string value;
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+        value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return value;
+}
+}
+
 struct ProductDatabaseTestFixture : public Test
 {
     void assertProductCategoriesAreEqual(const ProductCategory& lhs, const ProductCategory& rhs)
@@ -146,7 +209,7 @@ TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldStoreAndRetrieveEntities
     using namespace sqlite_orm;
     auto filteredInstances = db.retrieve<ProductInstance>(
         where(
-            c(column<ProductInstance>(&ProductInstance::getExpirationDateTimestamp)) > isoDateToTimestamp("2024-12-01")
+            c(&ProductInstance::expirationDate) > isoDateToDate("2024-12-01")
             and
             is_not_null(column<ProductInstance>(&ProductInstance::daysToExpireWhenOpened)))
     );
@@ -226,7 +289,7 @@ TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldUpdateEntitiesBothInCach
             firstDesc, templInst.purchaseDate, templInst.expirationDate,
             templInst.daysToExpireWhenOpened, templInst.isOpen, templInst.isConsumed);
     
-    instance->expirationDate = parseIsoDate("2025-01-31");
+    instance->expirationDate = isoDateToDate("2025-01-31");
     instance->daysToExpireWhenOpened = 5;
     instance->isConsumed = false;
     db.commitChanges(instance);
@@ -273,6 +336,549 @@ TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldUpdateEntitiesBothInCach
     assertProductCategoriesAreEqual(secondTemplCat, *instance->description->category);
 }
 
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldCreateManyEntitiesAtOnce)
+{
+    std::vector<ProductCategorySchema> categoriesSchemas(sampleProductCategories.begin(), sampleProductCategories.end());
+    auto categories = db.createMany<ProductCategory>(categoriesSchemas);
+    ASSERT_EQ(sampleProductCategories.size(), categories.size());
+
+    std::vector<ProductDescriptionSchema> descriptionsSchemas(sampleProductDescriptions.begin(), sampleProductDescriptions.end());
+    auto descriptions = db.createMany<ProductDescription>(categories.back(), descriptionsSchemas);
+    ASSERT_EQ(sampleProductDescriptions.size(), descriptions.size());
+
+    std::vector<ProductInstanceSchema> instancesSchemas(sampleProductInstances.begin(), sampleProductInstances.end());
+    auto instances = db.createMany<ProductInstance>(descriptions.front(), instancesSchemas);
+    ASSERT_EQ(sampleProductInstances.size(), instances.size());
+
+    auto allInstances = db.retrieveAll<ProductInstance>();
+    ASSERT_EQ(sampleProductInstances.size(), allInstances.size());
+    for(auto i = 0; i < sampleProductInstances.size(); ++i)
+    {
+        ASSERT_EQ(i + 1, allInstances[i]->getId());
+        ASSERT_EQ(instances[i].get(), allInstances[i].get());
+        assertProductInstancesAreEqual(sampleProductInstances[i], *allInstances[i]);
+        assertProductDescriptionsAreEqual(sampleProductDescriptions.front(), *allInstances[i]->description);
+        assertProductCategoriesAreEqual(sampleProductCategories.back(), *allInstances[i]->description->category);
+    }
+
+    for(auto i = 0; i < sampleProductDescriptions.size(); ++i)
+    {
+        auto description = db.retrieve<ProductDescription>(i + 1);
+        assertProductDescriptionsAreEqual(sampleProductDescriptions[i], *description);
+        ASSERT_EQ(categories.back()->getId(), description->getFkId());
+    }
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldPersistChangesMadeWithinSessionOnlyWhenItIsCommitted)
+{
+    const auto& templCat = sampleProductCategories.front();
+    const auto& templDesc = sampleProductDescriptions.front();
+    auto templInst = sampleProductInstances.front();
+
+    {
+    auto session = db.startSession();
+    auto category = db.create<ProductCategory>(templCat.name, templCat.imagePath, templCat.isArchived);
+    auto description = db.create<ProductDescription>(
+        category, templDesc.name, templDesc.barcode,
+        templDesc.daysValidSuggestion,
+        templDesc.imagePath, templDesc.isArchived);
+    for(const auto& inst : sampleProductInstances)
+    {
+        auto instance = db.create<ProductInstance>(
+            description, inst.purchaseDate, inst.expirationDate,
+            inst.daysToExpireWhenOpened, inst.isOpen, inst.isConsumed);
+        instance->isConsumed = true;
+        db.commitChanges(instance);
+    }
+    ASSERT_THROW(db.retrieve<ProductCategory>(1), std::system_error);
+    session.commit();
+    }
+
+    auto instances = db.retrieveAll<ProductInstance>();
+    ASSERT_EQ(sampleProductInstances.size(), instances.size());
+    templInst.isConsumed = true;
+    assertProductInstancesAreEqual(templInst, *instances.front());
+    assertProductDescriptionsAreEqual(templDesc, *instances.front()->description);
+    assertProductCategoriesAreEqual(templCat, *instances.front()->description->category);
+
+    {
+    auto session = db.startSession();
+    for(auto& instance : instances)
+        db.remove(std::move(instance));
+    ASSERT_NO_THROW(db.retrieve<ProductInstance>(1));
+    session.commit();
+    }
+    ASSERT_TRUE(db.retrieveAll<ProductInstance>().empty());
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldNotPersistChangesOfInterruptedSession)
+{
+    const auto& templCat = sampleProductCategories.front();
+    try
+    {
+        auto session = db.startSession();
+        db.create<ProductCategory>(templCat.name, templCat.imagePath, templCat.isArchived);
+        throw std::runtime_error("Interrupted");
+    }
+    catch(const std::runtime_error&)
+    {}
+
+    ASSERT_TRUE(db.retrieveAll<ProductCategory>().empty());
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldHandleInterleavedSingleEntityOperations)
+{
+    constexpr auto numOfEntities = 50;
+    for(auto i = 1; i <= numOfEntities; ++i)
+        db.create<ProductCategory>("cat" + std::to_string(i), std::nullopt, false);
+
+    for(auto i = numOfEntities; i > 0; --i)
+    {
+        auto category = db.retrieve<ProductCategory>(i);
+        ASSERT_EQ("cat" + std::to_string(i), category->name);
+        category->name = "renamed" + std::to_string(i);
+        db.commitChanges(category);
+        if(i % 2 == 0)
+            db.remove(std::move(category));
+    }
+
+    for(auto i = 1; i <= numOfEntities; ++i)
+    {
+        if(i % 2 == 0)
+        {
+            ASSERT_THROW(db.retrieve<ProductCategory>(i), std::system_error);
+            continue;
+        }
+
+        auto category = db.retrieve<ProductCategory>(i);
+        ASSERT_EQ("renamed" + std::to_string(i), category->name);
+    }
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldRetrieveByIdsSetLargerThanSqliteParametersLimit)
+{
+    constexpr auto numOfEntities = 2500;
+    std::vector<ProductCategorySchema> schemas(numOfEntities, ProductCategorySchema{.name = "cat", .imagePath = std::nullopt, .isArchived = false});
+    std::set<Id> ids;
+    {
+    auto categories = db.createMany<ProductCategory>(schemas);
+    for(const auto& category : categories)
+        ids.insert(category->getId());
+    }
+
+    auto someCategory = db.retrieve<ProductCategory>(numOfEntities / 2);
+    auto categories = db.retrieve<ProductCategory>(ids);
+    ASSERT_EQ(numOfEntities, categories.size());
+    for(auto i = 0; i < numOfEntities; ++i)
+        ASSERT_EQ(i + 1, categories[i]->getId());
+    ASSERT_EQ(someCategory.get(), categories[numOfEntities / 2 - 1].get());
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldLoadFkEntitiesOnDemandWhenLazyLoadingIsEnabled)
+{
+    {
+    std::vector<ProductCategorySchema> categoriesSchemas(sampleProductCategories.begin(), sampleProductCategories.end());
+    auto categories = db.createMany<ProductCategory>(categoriesSchemas);
+    std::vector<ProductDescriptionSchema> descriptionsSchemas(sampleProductDescriptions.begin(), sampleProductDescriptions.end());
+    auto descriptions = db.createMany<ProductDescription>(categories.front(), descriptionsSchemas);
+    std::vector<ProductInstanceSchema> instancesSchemas(sampleProductInstances.begin(), sampleProductInstances.end());
+    db.createMany<ProductInstance>(descriptions.back(), instancesSchemas);
+    }
+
+    db.setFkLoadingPolicy(FkLoadingPolicy::Lazy);
+    auto instances = db.retrieveAll<ProductInstance>();
+    ASSERT_EQ(sampleProductInstances.size(), instances.size());
+    for(auto i = 0; i < sampleProductInstances.size(); ++i)
+    {
+        assertProductInstancesAreEqual(sampleProductInstances[i], *instances[i]);
+        ASSERT_FALSE(instances[i]->description.isResolved());
+    }
+
+    db.resolveLazy(instances | std::views::transform([](auto& instance) -> auto& { return instance->description; }));
+    for(const auto& instance : instances)
+    {
+        ASSERT_TRUE(instance->description.isResolved());
+        assertProductDescriptionsAreEqual(sampleProductDescriptions.back(), *instance->description);
+        ASSERT_FALSE(instance->description->category.isResolved());
+        assertProductCategoriesAreEqual(sampleProductCategories.front(), *instance->description->category);
+    }
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldRetrieveWholeFkChainWithSingleJoinedQueryWhenJoiningIsEnabled)
+{
+    std::set<Id> ids;
+    {
+    std::vector<ProductCategorySchema> categoriesSchemas(sampleProductCategories.begin(), sampleProductCategories.end());
+    auto categories = db.createMany<ProductCategory>(categoriesSchemas);
+    auto firstDescription = db.create<ProductDescription>(categories[0], "desc1", std::nullopt, 3u, std::nullopt, false);
+    auto secondDescription = db.create<ProductDescription>(categories[1], "desc2", std::nullopt, 3u, std::nullopt, false);
+    for(std::size_t i = 0; i < sampleProductInstances.size(); ++i)
+    {
+        const auto& templInst = sampleProductInstances[i];
+        auto instance = db.create<ProductInstance>(
+            i % 2 == 0 ? firstDescription : secondDescription, templInst.purchaseDate, templInst.expirationDate,
+            templInst.daysToExpireWhenOpened, templInst.isOpen, templInst.isConsumed);
+        ids.insert(instance->getId());
+    }
+    }
+
+    db.setFkLoadingPolicy(FkLoadingPolicy::Joined);
+    auto instances = db.retrieve<ProductInstance>(ids);
+    ASSERT_EQ(sampleProductInstances.size(), instances.size());
+    for(std::size_t i = 0; i < instances.size(); ++i)
+    {
+        assertProductInstancesAreEqual(sampleProductInstances[i], *instances[i]);
+        ASSERT_TRUE(instances[i]->description.isResolved());
+        ASSERT_EQ(i % 2 == 0 ? "desc1" : "desc2", instances[i]->description->name);
+        ASSERT_TRUE(instances[i]->description->category.isResolved());
+        assertProductCategoriesAreEqual(sampleProductCategories[i % 2], *instances[i]->description->category);
+    }
+    //FK entities shared by many rows are cached only once
+    ASSERT_EQ(instances[0]->description.get(), instances[2]->description.get());
+    ASSERT_EQ(instances[0]->description.get(), db.retrieve<ProductDescription>(instances[0]->getFkId()).get());
+
+    using namespace sqlite_orm;
+    auto notConsumed = db.retrieve<ProductInstance>(where(c(&ProductInstance::isConsumed) == false));
+    ASSERT_EQ(4, notConsumed.size());
+    for(const auto& instance : notConsumed)
+        ASSERT_TRUE(instance->description->category.isResolved());
+    ASSERT_EQ(instances.size(), db.retrieveAll<ProductInstance>().size());
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldStreamEntitiesMatchingConditions)
+{
+    constexpr auto numOfInstances = 1000;
+    {
+    const auto& templCat = sampleProductCategories.front();
+    const auto& templDesc = sampleProductDescriptions.front();
+    auto category = db.create<ProductCategory>(templCat.name, templCat.imagePath, templCat.isArchived);
+    auto description = db.create<ProductDescription>(
+        category, templDesc.name, templDesc.barcode,
+        templDesc.daysValidSuggestion,
+        templDesc.imagePath, templDesc.isArchived);
+    std::vector<ProductInstanceSchema> instancesSchemas;
+    for(auto i = 0; i < numOfInstances; ++i)
+        instancesSchemas.push_back(sampleProductInstances[i % sampleProductInstances.size()]);
+    db.createMany<ProductInstance>(description, instancesSchemas);
+    }
+
+    using namespace sqlite_orm;
+    std::size_t streamedCount = 0;
+    Id previousId = uninitializedId;
+    for(auto& instance : db.retrieveStream<ProductInstance>(where(c(&ProductInstance::isConsumed) == false)))
+    {
+        ASSERT_FALSE(instance->isConsumed);
+        ASSERT_LT(previousId, instance->getId());
+        assertProductDescriptionsAreEqual(sampleProductDescriptions.front(), *instance->description);
+        previousId = instance->getId();
+        ++streamedCount;
+    }
+    ASSERT_EQ(numOfInstances / 2, streamedCount);
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldPageThroughEntitiesInBothDirections)
+{
+    {
+    const auto& templCat = sampleProductCategories.front();
+    const auto& templDesc = sampleProductDescriptions.front();
+    auto category = db.create<ProductCategory>(templCat.name, templCat.imagePath, templCat.isArchived);
+    auto description = db.create<ProductDescription>(
+        category, templDesc.name, templDesc.barcode,
+        templDesc.daysValidSuggestion,
+        templDesc.imagePath, templDesc.isArchived);
+    std::vector<ProductInstanceSchema> instancesSchemas(sampleProductInstances.begin(), sampleProductInstances.end());
+    db.createMany<ProductInstance>(description, instancesSchemas);
+    }
+
+    std::vector<std::pair<Date, Id>> expectedOrder;
+    for(auto i = 0; i < sampleProductInstances.size(); ++i)
+        expectedOrder.emplace_back(sampleProductInstances[i].expirationDate, i + 1);
+    std::ranges::sort(expectedOrder);
+
+    for(auto order : {SortOrder::Ascending, SortOrder::Descending})
+    {
+        std::vector<std::pair<Date, Id>> pagedOrder;
+        std::optional<PageKey<Date>> pageKey;
+        auto pagesCount = 0;
+        do
+        {
+            auto page = db.retrievePage<ProductInstance>(pageKey, 4, &ProductInstance::expirationDate, order);
+            ASSERT_EQ(4, page.entities.size());
+            ++pagesCount;
+            for(const auto& instance : page.entities)
+            {
+                pagedOrder.emplace_back(instance->expirationDate, instance->getId());
+                assertProductDescriptionsAreEqual(sampleProductDescriptions.front(), *instance->description);
+            }
+            pageKey = page.nextKey;
+        } while(pageKey);
+
+        //Instances fill up exactly two pages, so there's no third one coming back empty
+        ASSERT_EQ(2, pagesCount);
+        if(order == SortOrder::Descending)
+            std::ranges::reverse(pagedOrder);
+        ASSERT_EQ(expectedOrder, pagedOrder);
+    }
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldKeepExpirationIndexInSyncWithChangesOfInstances)
+{
+    const auto& templCat = sampleProductCategories.front();
+    const auto& templDesc = sampleProductDescriptions.front();
+    auto category = db.create<ProductCategory>(templCat.name, templCat.imagePath, templCat.isArchived);
+    auto description = db.create<ProductDescription>(
+        category, templDesc.name, templDesc.barcode,
+        templDesc.daysValidSuggestion,
+        templDesc.imagePath, templDesc.isArchived);
+    auto makeInstance = [this, &description](std::string_view expirationDate) {
+        return db.create<ProductInstance>(description, isoDateToDate("2024-01-01"), isoDateToDate(expirationDate), std::nullopt, false, false);
+    };
+
+    auto first = makeInstance("2024-03-10");
+    const auto from = isoDateToDate("2024-03-01");
+    const auto to = isoDateToDate("2024-04-01");
+    ASSERT_EQ(1, db.findExpiring(from, to).size());
+
+    auto second = makeInstance("2024-03-05");
+    auto third = makeInstance("2024-03-20");
+    auto fourth = makeInstance("2024-05-01");
+    auto expiring = db.retrieveExpiring(from, to);
+    ASSERT_EQ(3, expiring.size());
+    ASSERT_EQ(second.get(), expiring[0].get());
+    ASSERT_EQ(first.get(), expiring[1].get());
+    ASSERT_EQ(third.get(), expiring[2].get());
+
+    first->isConsumed = true;
+    db.commitChanges(first);
+    fourth->expirationDate = isoDateToDate("2024-03-01");
+    db.commitChanges(fourth);
+    db.remove(std::move(third));
+
+    const std::vector<ExpirationEntry> expected {
+        {isoDateToDate("2024-03-01"), fourth->getId()},
+        {isoDateToDate("2024-03-05"), second->getId()}
+    };
+    ASSERT_EQ(expected, db.findExpiring(from, to));
+    ASSERT_EQ(expected, db.findSoonestExpiring(5, from));
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldFindDescriptionsByBarcodes)
+{
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false);
+    std::vector<EntityPtr<ProductDescription>> descriptions;
+    for(const auto& templDesc : sampleProductDescriptions)
+    {
+        descriptions.push_back(db.create<ProductDescription>(
+            category, templDesc.name, templDesc.barcode,
+            templDesc.daysValidSuggestion,
+            templDesc.imagePath, templDesc.isArchived));
+    }
+
+    ASSERT_EQ(descriptions[0].get(), db.findByBarcode("12345").get());
+    ASSERT_EQ(descriptions[1].get(), db.findByBarcode("22456").get());
+    ASSERT_FALSE(db.findByBarcode("99999"));
+
+    descriptions[0]->barcode = "99999";
+    db.commitChanges(descriptions[0]);
+    descriptions[2]->barcode = "33333";
+    db.commitChanges(descriptions[2]);
+    db.remove(std::move(descriptions[1]));
+    auto fifthDescription = db.create<ProductDescription>(category, "prod5", std::string("55555"), 2u, std::nullopt, false);
+
+    const auto found = db.findByBarcodes({"12345", "22456", "99999", "33333", "55555"});
+    ASSERT_EQ(5, found.size());
+    ASSERT_FALSE(found[0]);
+    ASSERT_FALSE(found[1]);
+    ASSERT_EQ(descriptions[0].get(), found[2].get());
+    ASSERT_EQ(descriptions[2].get(), found[3].get());
+    ASSERT_EQ(fifthDescription.get(), found[4].get());
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldBuildBarcodeIndexFromDescriptionsAlreadyStoredInDb)
+{
+    std::set<Id> ids;
+    {
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false);
+    std::vector<ProductDescriptionSchema> descriptionsSchemas(sampleProductDescriptions.begin(), sampleProductDescriptions.end());
+    for(const auto& description : db.createMany<ProductDescription>(category, descriptionsSchemas))
+        ids.insert(description->getId());
+    }
+
+    auto description = db.findByBarcode("22456");
+    ASSERT_TRUE(description);
+    assertProductDescriptionsAreEqual(sampleProductDescriptions[1], *description);
+    ASSERT_TRUE(ids.contains(description->getId()));
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldAggregateInstancesWithoutLoadingThemToCache)
+{
+    std::vector<Id> descriptionIds;
+    {
+    auto firstCategory = db.create<ProductCategory>("cat1", std::nullopt, false);
+    auto secondCategory = db.create<ProductCategory>("cat2", std::nullopt, false);
+    auto makeDescription = [this](EntityPtr<ProductCategory> category, std::string name) {
+        return db.create<ProductDescription>(category, std::move(name), std::nullopt, 3u, std::nullopt, false);
+    };
+    std::array descriptions = {
+        makeDescription(firstCategory, "desc1"),
+        makeDescription(firstCategory, "desc2"),
+        makeDescription(secondCategory, "desc3"),
+        makeDescription(secondCategory, "desc4")
+    };
+    for(const auto& description : descriptions)
+        descriptionIds.push_back(description->getId());
+
+    auto makeInstance = [this](EntityPtr<ProductDescription> description, std::string_view purchaseDate,
+                               std::string_view expirationDate, bool isConsumed) {
+        db.create<ProductInstance>(description, isoDateToDate(purchaseDate), isoDateToDate(expirationDate), std::nullopt, false, isConsumed);
+    };
+    makeInstance(descriptions[0], "2024-11-02", "2024-11-10", false);
+    makeInstance(descriptions[0], "2024-11-05", "2024-12-01", true);
+    makeInstance(descriptions[1], "2024-10-20", "2024-11-20", false);
+    makeInstance(descriptions[2], "2024-11-15", "2025-01-05", false);
+    makeInstance(descriptions[2], "2024-09-01", "2024-10-01", true);
+    }
+    const auto allocatedInstances = db.getAllocationStats<ProductInstance>().allocatedEntities;
+
+    const InstanceAggregate all{5, isoDateToDate("2024-10-01"), isoDateToDate("2025-01-05")};
+    ASSERT_EQ(all, db.aggregateInstances());
+
+    const auto today = isoDateToDate("2024-11-18");
+    const InstanceAggregate expired{1, isoDateToDate("2024-11-10"), isoDateToDate("2024-11-10")};
+    ASSERT_EQ(expired, db.aggregateInstances({.isConsumed = false, .expiringBefore = today}));
+    const InstanceAggregate fresh{2, isoDateToDate("2024-11-20"), isoDateToDate("2025-01-05")};
+    ASSERT_EQ(fresh, db.aggregateInstances({.isConsumed = false, .expiringFrom = today}));
+    const InstanceAggregate consumedInNovember{1, isoDateToDate("2024-12-01"), isoDateToDate("2024-12-01")};
+    ASSERT_EQ(consumedInNovember, db.aggregateInstances({.isConsumed = true, .purchasedFrom = isoDateToDate("2024-11-01"),
+                                                         .purchasedBefore = isoDateToDate("2024-12-01")}));
+    ASSERT_EQ(InstanceAggregate{}, db.aggregateInstances({.expiringFrom = isoDateToDate("2030-01-01")}));
+
+    const std::vector<InstanceGroupAggregate> byCategory {
+        {1, "cat1", {3, isoDateToDate("2024-11-10"), isoDateToDate("2024-12-01")}},
+        {2, "cat2", {2, isoDateToDate("2024-10-01"), isoDateToDate("2025-01-05")}}
+    };
+    ASSERT_EQ(byCategory, db.aggregateInstancesBy(InstanceGrouping::Category));
+
+    const std::vector<InstanceGroupAggregate> notConsumedByDescription {
+        {descriptionIds[0], "desc1", {1, isoDateToDate("2024-11-10"), isoDateToDate("2024-11-10")}},
+        {descriptionIds[1], "desc2", {1, isoDateToDate("2024-11-20"), isoDateToDate("2024-11-20")}},
+        {descriptionIds[2], "desc3", {1, isoDateToDate("2025-01-05"), isoDateToDate("2025-01-05")}}
+    };
+    ASSERT_EQ(notConsumedByDescription, db.aggregateInstancesBy(InstanceGrouping::Description, {.isConsumed = false}));
+
+    ASSERT_EQ(allocatedInstances, db.getAllocationStats<ProductInstance>().allocatedEntities);
+}
+
+TEST_F(ProductDatabaseTestFixture, ProductDatabaseShouldSelectOnlyChosenColumnsWithoutCreatingEntities)
+{
+    {
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false);
+    auto description = db.create<ProductDescription>(category, "desc", std::nullopt, 3u, std::nullopt, false);
+    db.create<ProductInstance>(description, isoDateToDate("2024-11-01"), isoDateToDate("2024-12-01"), std::nullopt, true, false);
+    db.create<ProductInstance>(description, isoDateToDate("2024-11-02"), isoDateToDate("2024-11-20"), std::nullopt, false, false);
+    db.create<ProductInstance>(description, isoDateToDate("2024-11-03"), isoDateToDate("2024-11-25"), std::nullopt, false, true);
+    }
+    const auto allocatedInstances = db.getAllocationStats<ProductInstance>().allocatedEntities;
+    const auto allocatedDescriptions = db.getAllocationStats<ProductDescription>().allocatedEntities;
+
+    using namespace sqlite_orm;
+    auto expirationDate = column<ProductInstance>(&ProductInstance::expirationDate);
+    const std::vector<std::tuple<Date, bool>> expected {
+        {isoDateToDate("2024-11-20"), false},
+        {isoDateToDate("2024-12-01"), true}
+    };
+    ASSERT_EQ(expected, (db.select<ProductInstance, &ProductInstance::expirationDate, &ProductInstance::isOpen>(
+        where(c(&ProductInstance::isConsumed) == false), order_by(expirationDate))));
+
+    struct ListRow
+    {
+        std::string name;
+        Nullable<std::string> barcode;
+    };
+    const auto rows = db.selectAs<ListRow, ProductDescription, &ProductDescription::name, &ProductDescription::barcode>();
+    ASSERT_EQ(1, rows.size());
+    ASSERT_EQ("desc", rows[0].name);
+    ASSERT_FALSE(rows[0].barcode);
+
+    ASSERT_EQ(allocatedInstances, db.getAllocationStats<ProductInstance>().allocatedEntities);
+    ASSERT_EQ(allocatedDescriptions, db.getAllocationStats<ProductDescription>().allocatedEntities);
+}
+
+TEST(ProductDatabaseStorageTest, StandardQueriesShouldSearchIndexesInsteadOfScanningTables)
+{
+    using namespace sqlite_orm;
+    auto storage = internal::makeStorage();
+    storage.sync_schema();
+    const Id someId = 1;
+    const Date someDate = isoDateToDate("2024-12-01");
+    auto expirationDate = column<ProductInstance>(&ProductInstance::expirationDate);
+    auto instanceId = column<ProductInstance>(&ProductInstance::getId);
+
+    assertQueryDoesNotScanTable(storage.prepare(get<ProductInstance>(someId)));
+    assertQueryDoesNotScanTable(storage.prepare(get_all<ProductInstance>(where(in(instanceId, std::vector<Id>{1, 2, 3})))));
+    assertQueryDoesNotScanTable(storage.prepare(get_all<ProductDescription>(
+        where(c(column<ProductDescription>(&ProductDescription::getFkId)) == someId))));
+    assertQueryDoesNotScanTable(storage.prepare(get_all<ProductDescription>(
+        where(c(&ProductDescription::barcode) == "12345"))));
+    assertQueryDoesNotScanTable(storage.prepare(get_all<ProductInstance>(
+        where(c(column<ProductInstance>(&ProductInstance::getFkId)) == someId))));
+    assertQueryDoesNotScanTable(storage.prepare(get_all<ProductInstance>(
+        where(c(&ProductInstance::isConsumed) == false and c(expirationDate) < someDate))));
+    assertQueryDoesNotScanTable(storage.prepare(select(
+        columns(instanceId, expirationDate), where(c(&ProductInstance::isConsumed) == false))));
+    assertQueryDoesNotScanTable(storage.prepare(get_all<ProductInstance>(
+        where(c(expirationDate) >= someDate and (c(expirationDate) > someDate or c(instanceId) > someId)),
+        multi_order_by(order_by(expirationDate).asc(), order_by(instanceId).asc()), limit(20))), true);
+}
+
+TEST(ProductDatabaseMigrationTest, ProductDatabaseShouldConvertInstanceDatesStoredAsSecondsToDays)
+{
+    const TempDatabaseFile dbFile("FridgeGuardMigrationTest");
+    const auto& dbFilePath = dbFile.getPath();
+    {
+    //Database created before dates were stored as days has the same tables, but user_version left at 0
+    auto storage = internal::makeStorage(dbFilePath);
+    storage.sync_schema();
+    sqlite3* rawDb = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(dbFilePath.c_str(), &rawDb));
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(rawDb,
+        "INSERT INTO categories(name, isArchived) VALUES('cat', 0);"
+        "INSERT INTO descriptions(categoryId, name, isArchived) VALUES(1, 'desc', 0);"
+        "INSERT INTO instances(descriptionId, purchaseDate, expirationDate, isOpen, isConsumed)"
+        "    VALUES(1, 1673913600, 1735650000, 0, 0);",
+        nullptr, nullptr, nullptr));
+    sqlite3_close(rawDb);
+    }
+
+    for(auto i = 0; i < 2; ++i)
+    {
+        //Reopening already migrated database must leave dates intact
+        ProductDatabase db(dbFilePath);
+        auto instance = db.retrieve<ProductInstance>(1);
+        ASSERT_TRUE(instance);
+        ASSERT_EQ(isoDateToDate("2023-01-17"), instance->purchaseDate);
+        ASSERT_EQ(isoDateToDate("2024-12-31"), instance->expirationDate);
+    }
+}
+
+TEST(ProductDatabaseOptionsTest, ProductDatabaseShouldApplyOptionsToItsConnectionsBothInFileAndInMemory)
+{
+    const TempDatabaseFile dbFile("FridgeGuardOptionsTest");
+    sqlite3_auto_extension(reinterpret_cast<void(*)()>(&captureOpenedConnection));
+    {
+        //All connections get the same options, so it doesn't matter which of them was opened last
+        ProductDatabase db(dbFile.getPath(), DatabaseOptions::fast());
+        EXPECT_EQ("wal", queryPragma(lastOpenedConnection, "journal_mode"));
+        EXPECT_EQ("1", queryPragma(lastOpenedConnection, "synchronous"));
+    }
+    {
+        ProductDatabase db("", { .synchronous = DatabaseOptions::Synchronous::Off, .cacheSizeKiB = 1024 });
+        EXPECT_EQ("0", queryPragma(lastOpenedConnection, "synchronous"));
+        EXPECT_EQ("-1024", queryPragma(lastOpenedConnection, "cache_size"));
+    }
+    sqlite3_cancel_auto_extension(reinterpret_cast<void(*)()>(&captureOpenedConnection));
+}
+
 /* Generic entities management tests */
 
 template<typename T>
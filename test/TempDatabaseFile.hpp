@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <random>
+#include <string>
+
+namespace FG::data::test
+{
+//Database file in temporary directory with name unique for every instance, so concurrently running tests never share it.
+//File is removed together with its WAL and shared memory files when going out of scope.
+class TempDatabaseFile
+{
+public:
+    explicit TempDatabaseFile(const std::string& namePrefix)
+        : path((std::filesystem::temp_directory_path() / (namePrefix + "-" + makeUniqueSuffix() + ".db")).string())
+    {
+        remove();
+    }
+
+    TempDatabaseFile(const TempDatabaseFile&) = delete;
+
+    TempDatabaseFile& operator=(const TempDatabaseFile&) = delete;
+
+    ~TempDatabaseFile()
+    {
+        remove();
+    }
+
+    const std::string& getPath() const
+    {
+        return path;
+    }
+
+private:
+    static std::string makeUniqueSuffix()
+    {
+        std::random_device randomDevice;
+        return std::to_string(randomDevice()) + std::to_string(randomDevice());
+    }
+
+    void remove() const
+    {
+        for(const auto* suffix : {"", "-wal", "-shm"})
+            std::filesystem::remove(path + suffix);
+    }
+
+    std::string path;
+};
+}
\ No newline at end of file
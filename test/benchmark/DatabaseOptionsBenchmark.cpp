@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include "ProductDatabase.hpp"
+#include "../TempDatabaseFile.hpp"
+
+using namespace testing;
+
+namespace FG::data::benchmark
+{
+namespace
+{
+struct Latencies
+{
+    double writeUs;
+    double readUs;
+};
+
+double microsecondsPerOperation(std::chrono::steady_clock::duration duration, std::size_t numOfOperations)
+{
+    return std::chrono::duration<double, std::micro>(duration).count() / numOfOperations;
+}
+
+//Every instance is created in its own transaction, then read back from db in random order
+Latencies measureLatencies(const DatabaseOptions& options, std::size_t numOfInstances)
+{
+    const test::TempDatabaseFile dbFile("FridgeGuardOptionsBenchmark");
+    Latencies latencies;
+    ProductDatabase db(dbFile.getPath(), options);
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false);
+    auto description = db.create<ProductDescription>(category, "desc", std::nullopt, 3u, std::nullopt, false);
+    const auto purchaseDate = isoDateToDate("2024-01-01");
+
+    std::vector<Id> ids;
+    ids.reserve(numOfInstances);
+    const auto writeStart = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < numOfInstances; ++i)
+    {
+        auto instance = db.create<ProductInstance>(description, purchaseDate, Date(purchaseDate.getDaysSinceEpoch() + static_cast<Date::rep>(i % 365)),
+                                                   std::nullopt, false, false);
+        ids.push_back(instance->getId());
+    }
+    latencies.writeUs = microsecondsPerOperation(std::chrono::steady_clock::now() - writeStart, numOfInstances);
+
+    //Instances are no longer referenced, so they have to be fetched from db again
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(1234));
+    const auto readStart = std::chrono::steady_clock::now();
+    for(Id id : ids)
+        EXPECT_TRUE(db.retrieve<ProductInstance>(id));
+    latencies.readUs = microsecondsPerOperation(std::chrono::steady_clock::now() - readStart, numOfInstances);
+    return latencies;
+}
+}
+
+TEST(DatabaseOptionsBenchmark, FastPresetShouldLowerWriteLatencyComparedToSqliteDefaults)
+{
+    constexpr std::size_t numOfInstances = 2'000;
+    const std::vector<std::pair<const char*, DatabaseOptions>> presets {
+        {"defaults", DatabaseOptions{}},
+        {"durable", DatabaseOptions::durable()},
+        {"fast", DatabaseOptions::fast()}
+    };
+
+    std::vector<Latencies> results;
+    for(const auto& [name, options] : presets)
+    {
+        results.push_back(measureLatencies(options, numOfInstances));
+        std::cout << name << ": write " << results.back().writeUs << " us, read " << results.back().readUs << " us" << std::endl;
+    }
+
+    ASSERT_LT(results[2].writeUs, results[0].writeUs);
+}
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <time.h>
+#include <gtest/gtest.h>
+#include "DatetimeUtils.hpp"
+
+using namespace testing;
+
+namespace FG::data::benchmark
+{
+namespace
+{
+//Previous stringstream and std::get_time based implementation, kept as a baseline
+Timestamp legacyIsoDateToTimestamp(std::string_view dtStr)
+{
+    std::tm tm{};
+    std::stringstream ss;
+    ss << dtStr;
+    ss << "T00:00:00";
+    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    if(ss.fail())
+        throw std::runtime_error("Parsing date failed");
+    return timegm(&tm);
+}
+
+std::vector<std::string> makeDates(std::size_t count)
+{
+    std::vector<std::string> dates;
+    dates.reserve(count);
+    const auto firstDay = std::chrono::sys_days(std::chrono::year_month_day(std::chrono::year(1990), std::chrono::January, std::chrono::day(1)));
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const std::chrono::year_month_day ymd(firstDay + std::chrono::days(i % 20'000));
+        std::ostringstream ss;
+        ss << static_cast<int>(ymd.year()) << '-' << std::setw(2) << std::setfill('0') << static_cast<unsigned>(ymd.month())
+           << '-' << std::setw(2) << std::setfill('0') << static_cast<unsigned>(ymd.day());
+        dates.push_back(ss.str());
+    }
+    return dates;
+}
+
+template<typename Func>
+double measure(Func&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+TEST(DateParsingBenchmark, IsoDateParserShouldBeFasterThanStringstreamBasedOne)
+{
+    constexpr std::size_t numOfDates = 200'000;
+    const auto dates = makeDates(numOfDates);
+    const std::vector<std::string_view> dateViews(dates.begin(), dates.end());
+    std::vector<Timestamp> legacyTimestamps(numOfDates);
+    std::vector<Timestamp> timestamps(numOfDates);
+    std::vector<Timestamp> bulkTimestamps(numOfDates);
+
+    const auto legacyTime = measure([&] {
+        for(std::size_t i = 0; i < numOfDates; ++i)
+            legacyTimestamps[i] = legacyIsoDateToTimestamp(dateViews[i]);
+    });
+    const auto time = measure([&] {
+        for(std::size_t i = 0; i < numOfDates; ++i)
+            timestamps[i] = isoDateToTimestamp(dateViews[i]);
+    });
+    const auto bulkTime = measure([&] {
+        isoDatesToTimestamps(dateViews, bulkTimestamps);
+    });
+    std::cout << numOfDates << " dates: stringstream " << legacyTime << " ms, parser " << time
+              << " ms, bulk parser " << bulkTime << " ms" << std::endl;
+
+    ASSERT_EQ(legacyTimestamps, timestamps);
+    ASSERT_EQ(legacyTimestamps, bulkTimestamps);
+    ASSERT_LT(time, legacyTime);
+    ASSERT_LT(bulkTime, legacyTime);
+}
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Database.hpp"
+
+using namespace testing;
+
+namespace FG::data::benchmark
+{
+namespace
+{
+struct ParentSchema
+{
+    int number;
+};
+using ParentEntity = DbEntity<ParentSchema>;
+
+struct ChildSchema
+{
+    using FkEntity = ParentEntity;
+
+    int number;
+};
+
+struct ChildEntity : public DbEntity<ChildSchema>
+{
+    using Base = DbEntity<ChildSchema>;
+
+    explicit ChildEntity() : Base()
+    {}
+
+    ChildEntity(ChildSchema&& data) : Base(std::move(data))
+    {}
+
+    void setFkEntity(EntityPtr<const ParentEntity> newParent)
+    {
+        parent = newParent;
+        setFkId(newParent->getId());
+    }
+
+    EntityPtr<const ParentEntity> parent;
+};
+
+class InMemoryDatabase : public Database<InMemoryDatabase, ParentEntity, ChildEntity>
+{
+public:
+    InMemoryDatabase(std::size_t numOfChildren, std::size_t numOfParents)
+    {
+        parents.reserve(numOfParents);
+        for(std::size_t i = 1; i <= numOfParents; ++i)
+        {
+            parents.emplace_back(ParentSchema{static_cast<int>(i)});
+            parents.back().setId(i);
+        }
+
+        children.reserve(numOfChildren);
+        for(std::size_t i = 1; i <= numOfChildren; ++i)
+        {
+            children.emplace_back(ChildSchema{static_cast<int>(i)});
+            children.back().setId(i);
+            children.back().setFkId(1 + (i * 7919) % numOfParents);
+        }
+    }
+
+    template<typename EntityT>
+    std::vector<EntityT> retrieveImpl(const std::set<Id>& ids)
+    {
+        std::vector<EntityT> entities;
+        entities.reserve(ids.size());
+        for(Id id : ids)
+            entities.push_back(parents[id - 1]);
+        return entities;
+    }
+
+    template<typename EntityT>
+    std::vector<EntityT> retrieveImpl()
+    {
+        return children;
+    }
+
+private:
+    std::vector<ParentEntity> parents;
+    std::vector<ChildEntity> children;
+};
+
+auto measureRetrieveAll(std::size_t numOfChildren)
+{
+    InMemoryDatabase db(numOfChildren, numOfChildren / 10);
+    const auto start = std::chrono::steady_clock::now();
+    auto children = db.retrieveAll<ChildEntity>();
+    const auto duration = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(numOfChildren, children.size());
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+}
+
+TEST(FkResolutionBenchmark, RetrievingEntitiesWithFkShouldScaleLinearlyWithNumberOfEntities)
+{
+    constexpr std::size_t baseNumOfChildren = 20'000;
+    constexpr std::size_t scale = 8;
+
+    measureRetrieveAll(baseNumOfChildren);
+    const auto baseTime = measureRetrieveAll(baseNumOfChildren);
+    const auto scaledTime = measureRetrieveAll(baseNumOfChildren * scale);
+    std::cout << baseNumOfChildren << " entities: " << baseTime << " ms, "
+              << baseNumOfChildren * scale << " entities: " << scaledTime << " ms" << std::endl;
+
+    //Quadratic join would take scale^2 times longer, leave generous margin for log factors and noise
+    ASSERT_LT(scaledTime, baseTime * scale * 3);
+}
+}
\ No newline at end of file
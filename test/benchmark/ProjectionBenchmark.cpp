@@ -0,0 +1,55 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "ProductDatabase.hpp"
+
+using namespace testing;
+
+namespace FG::data::benchmark
+{
+namespace
+{
+constexpr std::size_t numOfInstances = 50'000;
+
+template<typename Func>
+double measureMilliseconds(Func&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+TEST(ProjectionBenchmark, SelectingListColumnsShouldBeCheaperThanRetrievingEntities)
+{
+    ProductDatabase db;
+    {
+    auto session = db.startSession();
+    auto category = db.create<ProductCategory>("cat", std::nullopt, false);
+    std::vector<EntityPtr<ProductDescription>> descriptions;
+    for(auto i = 0; i < 100; ++i)
+        descriptions.push_back(db.create<ProductDescription>(category, "description " + std::to_string(i), std::nullopt, 3u, std::nullopt, false));
+
+    const auto purchaseDate = isoDateToDate("2024-01-01");
+    for(std::size_t i = 0; i < numOfInstances; ++i)
+    {
+        db.create<ProductInstance>(descriptions[i % descriptions.size()], purchaseDate,
+                                   Date(purchaseDate.getDaysSinceEpoch() + static_cast<Date::rep>(i % 365)), std::nullopt, false, false);
+    }
+    session.commit();
+    }
+
+    //Entities are dropped right away, so every run has to fetch them from db again
+    const auto retrieveTime = measureMilliseconds([&db] {
+        EXPECT_EQ(numOfInstances, db.retrieveAll<ProductInstance>().size());
+    });
+    const auto selectTime = measureMilliseconds([&db] {
+        EXPECT_EQ(numOfInstances, (db.select<ProductInstance, &ProductInstance::expirationDate, &ProductInstance::isOpen>().size()));
+    });
+    std::cout << numOfInstances << " instances: retrieveAll " << retrieveTime << " ms, select " << selectTime << " ms" << std::endl;
+
+    ASSERT_LT(selectTime * 2, retrieveTime);
+}
+}
\ No newline at end of file